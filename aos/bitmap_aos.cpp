@@ -1,5 +1,11 @@
 #include "bitmap_aos.hpp"
 #include "common/file_error.hpp"
+#include "common/normalized_pixel.hpp"
+#include "common/gray.hpp"
+#include "common/planar.hpp"
+#include "common/row_io.hpp"
+#include <algorithm>
+#include <cstring>
 #include <fstream>
 #include<omp.h>
 namespace images::aos {
@@ -7,6 +13,18 @@ namespace images::aos {
   bitmap_aos::bitmap_aos(int w, int h) : header{w, h}, pixels(static_cast<std::size_t>(w * h)) {
   }
 
+  bool bitmap_aos::operator==(const bitmap_aos & other) const noexcept {
+    if (header != other.header) { return false; }
+    if (single_channel == other.single_channel) {
+      return single_channel ? gray_pixels == other.gray_pixels : pixels == other.pixels;
+    }
+    const auto & gray = single_channel ? *this : other;
+    const auto & colour = single_channel ? other : *this;
+    return std::ranges::equal(gray.gray_pixels, colour.pixels, [](uint8_t level, pixel p) {
+      return p == pixel{level, level, level};
+    });
+  }
+
   void bitmap_aos::read(const std::filesystem::path & in_name) {
     using namespace images::common;
     std::ifstream in{in_name};
@@ -15,125 +33,195 @@ namespace images::aos {
     }
     header.read(in);
 
-    const int extra = (width() * 3) % 4;
-    const int pixels_size = height() * width();
-    pixels.reserve(pixels_size);
-    for (int r = 0; r < height(); ++r) {
-      for (int c = 0; c < width(); ++c) {
-        pixel pixel_value{};
-        pixel_value.read(in);
-        pixels.push_back(pixel_value);
-      }
-      if (extra != 0) {
-        in.ignore(4 - extra);
+    static_assert(sizeof(pixel) == num_channels, "pixels must be stored as packed BGR triplets");
+    // Rows are kept as gray levels for as long as every row read is gray, and expanded to pixels
+    // at the first one with some colour. Rows of a gray palette file are the levels already.
+    const bool palettized = header.is_gray_palette();
+    single_channel = true;
+    pixels = std::vector<pixel>{};
+    gray_pixels.resize(header.image_size());
+    row_reader reader{in, header};
+    for (int rows = reader.next_band(); rows > 0; rows = reader.next_band()) {
+      for (int i = 0; i < rows; ++i) {
+        const auto row = reader.row(i);
+        const int first = index(reader.band_start() + i, 0);
+        if (palettized) {
+          std::memcpy(gray_pixels.data() + first, row.data(), row.size());
+          continue;
+        }
+        if (single_channel and is_gray_bgr(row)) {
+          for (int c = 0; c < width(); ++c) { gray_pixels[first + c] = row[c * num_channels]; }
+          continue;
+        }
+        if (single_channel) {
+          gray_pixels.resize(static_cast<std::size_t>(first));
+          expand_colors();
+          pixels.resize(header.image_size());
+        }
+        std::memcpy(pixels.data() + first, row.data(), row.size());
       }
     }
-
-  }
-
-  namespace {
-    void write_padding(std::ostream & os, int n) noexcept {
-      std::array<uint8_t, 3> pad_pixel{};
-      // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
-      os.write(reinterpret_cast<char *>(pad_pixel.data()), n);
-    }
+    if (palettized) { header = header.true_color(); }
   }
 
-  void bitmap_aos::write(const std::filesystem::path & out_name) {
+  void bitmap_aos::write(const std::filesystem::path & out_name, bool gray_palette) {
     using namespace images::common;
     std::ofstream out{out_name};
     if (!out) {
       throw file_error{file_error_kind::cannot_open};
     }
 
-    header.write(out);
-    const int padding = (4 - (width() * 3) % 4) % 4;
+    const bool palettized = single_channel and gray_palette;
+    const auto out_header = palettized ? header.gray_palette() : header;
+    out_header.write(out);
+    row_writer writer{out, out_header};
     for (int r = 0; r < height(); ++r) {
-      for (int c = 0; c < width(); ++c) {
-        auto pixel_value = get_pixel(r, c);
-        pixel_value.write(out);
+      const auto row = writer.next_row();
+      if (!single_channel) {
+        std::memcpy(row.data(), pixels.data() + index(r, 0), row.size());
+      }
+      else if (palettized) {
+        std::memcpy(row.data(), gray_pixels.data() + index(r, 0), row.size());
+      }
+      else {
+        const uint8_t * gray = gray_pixels.data() + index(r, 0);
+        interleave_bgr({gray, gray, gray}, row);
       }
-      write_padding(out, padding);
     }
+    writer.flush();
   }
 
   void bitmap_aos::to_gray() noexcept {
-    const auto max = std::ssize(pixels);
-#pragma omp parallel for default(none) shared(max)
-    for (int i = 0; i < max; ++i) {
-      pixels[i] = pixels[i].to_gray_corrected();
+    const int rows = height();
+    if (single_channel) {
+#pragma omp parallel for schedule(runtime) default(none) shared(rows)
+      for (int r = 0; r < rows; ++r) {
+        gray_plane_to_gray(std::span{gray_pixels}.subspan(index(r, 0), width()));
+      }
+      return;
     }
+    gray_pixels.resize(pixels.size());
+#pragma omp parallel for schedule(runtime) default(none) shared(rows)
+    for (int r = 0; r < rows; ++r) {
+      row_to_gray(r);
+    }
+    drop_colors();
   }
 
   bool bitmap_aos::is_gray() const noexcept {
-    const auto max = std::ssize(pixels);
-    for (int i = 0; i < max; ++i) {
-      if (!pixels[i].is_gray()) { return false; }
-    }
-    return true;
-  }
-
-  namespace {
-    constexpr std::array<int, 25> gauss_kernel{1, 4, 7, 4, 1, 4, 16, 26, 16, 4, 7, 26, 41, 26, 7, 4,
-                                               16, 26, 16, 4, 1, 4, 7, 4, 1};
-
-    constexpr int gauss_norm = 273;
-    constexpr auto gauss_size = std::ssize(gauss_kernel);
-  }
-
-    void bitmap_aos::gauss() noexcept {
-      bitmap_aos result{*this};
-      const auto num_pixels = std::ssize(pixels);
-#pragma omp parallel default(none) shared(num_pixels, result, gauss_kernel)
-      {
-        const auto [pixels_width, pixels_height] = get_size();
-#pragma omp for
-        for (int pixel_index = 0; pixel_index < num_pixels; ++pixel_index) {
-          const auto [row, column] = get_pixel_position(pixel_index);
-          color_accumulator accum;
-          for (int gauss_index = 0; gauss_index < gauss_size; ++gauss_index) {
-            const int column_offset = (gauss_index % 5) - 2;
-            const int j = column + column_offset;
-            if (j < 0 || j >= pixels_width) { continue; }
-            const int row_offset = (gauss_index / 5) - 2;
-            const int i = row + row_offset;
-            if (i < 0 || i >= pixels_height) { continue; }
-            // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-constant-array-index)
-            const int gauss_value = gauss_kernel[gauss_index];
-            const auto gauss_pixel_index = index(i, j);
-            accum += pixels[gauss_pixel_index] * gauss_value;
-          }
-          result.pixels[pixel_index] = accum / gauss_norm;
-        }
-      };
-      *this = result;
+    if (single_channel) { return true; }
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    return is_gray_bgr({reinterpret_cast<const uint8_t *>(pixels.data()),
+                        pixels.size() * num_channels});
+  }
+
+  void bitmap_aos::gauss(gauss_mode mode, int iterations) noexcept {
+    gauss_blur_iterated(channel_bytes(), height(), width() * step(), step(), iterations, mode);
+  }
+
+  void bitmap_aos::filter(convolution_filter kind) noexcept {
+    apply_filter(channel_bytes(), height(), width() * step(), step(), kind);
+  }
+
+  void bitmap_aos::blur(double sigma) noexcept {
+    box_gaussian_blur(channel_bytes(), height(), width() * step(), step(), sigma);
+  }
+
+  void bitmap_aos::gauss_to_gray(gauss_mode mode, int iterations) noexcept {
+    if (single_channel) {
+      gauss(mode, iterations);
+      to_gray();
+      return;
+    }
+    gray_pixels.resize(pixels.size());
+    gauss_blur_iterated(channel_bytes(), height(), width() * num_channels, num_channels,
+        iterations, mode, detected_simd_level(), [this](int r) { row_to_gray(r); });
+    drop_colors();
+  }
+
+  void bitmap_aos::row_to_gray(int r) noexcept {
+    const auto & gray = gray_levels();
+    const int last = index(r + 1, 0);
+    for (int i = index(r, 0); i < last; ++i) {
+      gray_pixels[i] = gray(pixels[i].red(), pixels[i].green(), pixels[i].blue());
+    }
+  }
+
+  void bitmap_aos::drop_colors() noexcept {
+    pixels = std::vector<pixel>{};
+    single_channel = true;
+  }
+
+  void bitmap_aos::expand_colors() {
+    pixels.resize(gray_pixels.size());
+    for (std::size_t i = 0; i < pixels.size(); ++i) {
+      pixels[i] = pixel{gray_pixels[i], gray_pixels[i], gray_pixels[i]};
     }
+    gray_pixels = std::vector<uint8_t>{};
+    single_channel = false;
+  }
+
+  // Packed BGR rows, where taps of the same channel are one pixel, three bytes, apart, or the
+  // gray levels one byte apart
+  std::span<uint8_t> bitmap_aos::channel_bytes() noexcept {
+    if (single_channel) { return gray_pixels; }
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    return {reinterpret_cast<uint8_t *>(pixels.data()), pixels.size() * num_channels};
+  }
 
   histogram bitmap_aos::generate_histogram() const noexcept {
-      histogram histo;
-      const int pixel_count = width() * height();
-      int i;
-      int nthreads;
-#pragma omp parallel default(none) shared(nthreads)
-      {
-    #pragma omp single
-          {
-              nthreads = omp_get_num_threads();
-          }
-      }
-      std::vector<histogram> h(nthreads);
+    if (single_channel) { return gray_plane_histogram(false); }
+    const int rows = height();
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    const std::span bytes{reinterpret_cast<const uint8_t *>(pixels.data()),
+                          pixels.size() * num_channels};
+    histogram_counters counters;
+#pragma omp parallel for schedule(runtime) default(none) shared(rows, bytes, counters)
+    for (int r = 0; r < rows; ++r) {
+      counters.count_bgr(omp_get_thread_num(),
+          bytes.subspan(static_cast<std::size_t>(index(r, 0)) * num_channels,
+                        static_cast<std::size_t>(width()) * num_channels));
+    }
+    return counters.merge();
+  }
 
-#pragma omp parallel default(none) shared(pixel_count, h)
-      {
-    #pragma omp for
-      for (i = 0; i < pixel_count; ++i) {
-          h[omp_get_thread_num()].add_color(pixels[i]);
+  // Counts each gray level once for all channels, through to_gray if asked to
+  histogram bitmap_aos::gray_plane_histogram(bool to_gray) const noexcept {
+    const int rows = height();
+    histogram_counters counters;
+    const auto & map = gray_of_gray();
+#pragma omp parallel for schedule(runtime) default(none) shared(rows, counters, map, to_gray)
+    for (int r = 0; r < rows; ++r) {
+      const auto levels = std::span{gray_pixels}.subspan(index(r, 0), width());
+      if (to_gray) {
+        counters.count_gray(omp_get_thread_num(), levels, map);
+      }
+      else {
+        counters.count_gray(omp_get_thread_num(), levels);
       }
+    }
+    return counters.merge();
   }
-      //now I have to merge all the h[i] into histo
-      histo.merge_histos(h, nthreads);
 
-      return histo;
+  // Converts a row at a time into a buffer of each thread and counts the levels once
+  histogram bitmap_aos::gray_histogram() const noexcept {
+    if (single_channel) { return gray_plane_histogram(true); }
+    const int rows = height();
+    histogram_counters counters;
+    const auto & gray = gray_levels();
+#pragma omp parallel default(none) shared(rows, counters, gray)
+    {
+      std::vector<uint8_t> levels(static_cast<std::size_t>(width()));
+#pragma omp for schedule(runtime)
+      for (int r = 0; r < rows; ++r) {
+        const pixel * row = pixels.data() + index(r, 0);
+        for (std::size_t c = 0; c < levels.size(); ++c) {
+          levels[c] = gray(row[c].red(), row[c].green(), row[c].blue());
+        }
+        counters.count_gray(omp_get_thread_num(), levels);
+      }
+    }
+    return counters.merge();
   }
 
   void bitmap_aos::print_info(std::ostream & os) const noexcept {
@@ -141,10 +229,19 @@ namespace images::aos {
   }
 
   pixel bitmap_aos::get_pixel(int r, int c) const noexcept {
+    if (single_channel) {
+      const auto level = gray_pixels[index(r, c)];
+      return pixel{level, level, level};
+    }
     return pixels[index(r, c)];
   }
 
-  void bitmap_aos::set_pixel(int r, int c, pixel p) noexcept {
+  void bitmap_aos::set_pixel(int r, int c, pixel p) {
+    if (single_channel and p.is_gray()) {
+      gray_pixels[index(r, c)] = p.red();
+      return;
+    }
+    if (single_channel) { expand_colors(); }
     pixels[index(r, c)] = p;
   }
 
@@ -155,11 +252,12 @@ namespace images::aos {
   void print_diff(const bitmap_aos & bm1, const bitmap_aos & bm2) noexcept {
     std::cout << "Printing differences:\n";
     print_diff(bm1.header, bm2.header);
-    const auto num_pixels = std::ssize(bm1.pixels);
+    const auto num_pixels = bm1.header.image_size();
     for (int i = 0; i < num_pixels; ++i) {
-      if (bm1.pixels[i] != bm2.pixels[i]) {
+      const auto [r, c] = bm1.get_pixel_position(i);
+      if (bm1.get_pixel(r, c) != bm2.get_pixel(r, c)) {
         std::cout << "  Pixel " << i << " is different";
-        std::cout << bm1.pixels[i] << " -- " << bm2.pixels[i] << "\n";
+        std::cout << bm1.get_pixel(r, c) << " -- " << bm2.get_pixel(r, c) << "\n";
         return;
       }
     }
@@ -6,6 +6,10 @@
 #include "common/bitmap_header.hpp"
 #include "common/pixel.hpp"
 #include "common/histogram.hpp"
+#include "common/gauss.hpp"
+#include "common/convolution.hpp"
+#include "common/box_blur.hpp"
+#include <span>
 #include <omp.h>
 
 namespace images::aos {
@@ -17,14 +21,26 @@ namespace images::aos {
     explicit bitmap_aos() noexcept = default;
     bitmap_aos(int w, int h);
 
-    bool operator==(const bitmap_aos &) const noexcept = default;
+    // Compares headers and pixel values, whether each image keeps one byte per pixel or three
+    bool operator==(const bitmap_aos & other) const noexcept;
 
     void read(const std::filesystem::path & in_name);
-    void write(const std::filesystem::path & out_name);
+    // A gray image is expanded to 24 bits per pixel unless gray_palette asks for 8 bits indexing
+    // a gray palette
+    void write(const std::filesystem::path & out_name, bool gray_palette = false);
 
+    // Images found gray when read, and those converted to gray, keep one byte per pixel until
+    // set_pixel stores a colour
     void to_gray() noexcept;
-    void gauss() noexcept;
+    void gauss(gauss_mode mode = gauss_mode::exact, int iterations = 1) noexcept;
+    void filter(convolution_filter kind) noexcept;
+    // Gaussian blur of standard deviation sigma pixels, approximated by stacked box blurs
+    void blur(double sigma) noexcept;
+    // gauss followed by to_gray, converting each row as soon as it is blurred
+    void gauss_to_gray(gauss_mode mode = gauss_mode::exact, int iterations = 1) noexcept;
     [[nodiscard]] histogram generate_histogram() const noexcept;
+    // Histogram of the image to_gray would give, without converting it
+    [[nodiscard]] histogram gray_histogram() const noexcept;
     void print_info(std::ostream & os) const noexcept;
 
     [[nodiscard]] int width() const noexcept { return header.width(); }
@@ -42,15 +58,27 @@ namespace images::aos {
     [[nodiscard]] bool is_gray() const noexcept;
 
     [[nodiscard]] pixel get_pixel(int r, int c) const noexcept;
-    void set_pixel(int r, int c, common::pixel p) noexcept;
+    void set_pixel(int r, int c, common::pixel p);
 
     friend void print_diff(const bitmap_aos & bm1, const bitmap_aos & bm2) noexcept;
 
   private:
     [[nodiscard]] int index(int r, int c) const noexcept;
+    void row_to_gray(int r) noexcept;
+    void drop_colors() noexcept;
+    void expand_colors();
+    [[nodiscard]] std::span<uint8_t> channel_bytes() noexcept;
+
+    // Distance between the bytes of one channel
+    [[nodiscard]] int step() const noexcept { return single_channel ? 1 : num_channels; }
+
+    [[nodiscard]] histogram gray_plane_histogram(bool to_gray) const noexcept;
 
     bitmap_header header{};
     std::vector<pixel> pixels;
+    // Levels of a gray image, which then has no pixels
+    std::vector<uint8_t> gray_pixels;
+    bool single_channel = false;
   };
 
 } // namespace images::aos
@@ -1,23 +1,36 @@
 #include "bitmap_header.hpp"
 #include "file_error.hpp"
 
+#include <algorithm>
 #include <iostream>
 #include <span>
 
 namespace {
+  constexpr int file_size_offset = 2;
   constexpr int pixel_start_offset = 10;
+  constexpr int info_size_offset = 14;
   constexpr int width_offset = 18;
   constexpr int header_offset = 22;
   constexpr int planes_offset = 26;
   constexpr int bit_count_offset = 28;
   constexpr int compression_offset = 30;
+  constexpr int image_size_offset = 34;
+  constexpr int colors_used_offset = 46;
 
   constexpr int expected_bit_count = 24;
 
+  // BITMAPINFOHEADER, the smallest info header, which a palette directly follows
+  constexpr int32_t info_header_size = 40;
+  // The info header starts right after the 14 bytes of the file header
+  constexpr int file_header_size = info_size_offset;
+  constexpr int palette_levels = 256;
+  constexpr int palette_entry_size = 4;
+  constexpr std::size_t num_palette_channels = 3;
+
   template<typename T, typename S>
   T get_value(S buffer, int offset) noexcept {
     // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
-    return *reinterpret_cast<T *>(buffer.data() + offset);
+    return *reinterpret_cast<const T *>(buffer.data() + offset);
   }
 
   template<typename T, typename S>
@@ -40,6 +53,8 @@ namespace images::common {
   bitmap_header::bitmap_header(int w, int h) noexcept: pixel_start_{header_size}, width_{w},
                                                        height_{h} {
     const std::span header_view{header_info};
+    header_view[0] = 'B';
+    header_view[1] = 'M';
     set_value(pixel_start_, header_view, pixel_start_offset);
     set_value(width_, header_view, width_offset);
     set_value(height_, header_view, header_offset);
@@ -89,7 +104,8 @@ namespace images::common {
     compression_ = get_value<int32_t>(header_view, compression_offset);
 
     check_file_error(planes_ == 1, invalid_planes);
-    check_file_error(bit_count_ == expected_bit_count, invlaid_bit_count);
+    check_file_error(bit_count_ == expected_bit_count or bit_count_ == gray_bit_count,
+        invlaid_bit_count);
     check_file_error(compression_ == 0, invalid_compression);
 
     extra_size_ = static_cast<int>(pixel_start_) - header_size;
@@ -97,6 +113,72 @@ namespace images::common {
     extra_buffer.resize(extra_size_);
     is.read(extra_buffer.data(), extra_size_);
     check_file_error(static_cast<bool>(is), cannot_read_extra);
+    // Only the 8-bit files that gray_palette describes are read
+    check_file_error(bit_count_ == expected_bit_count or has_gray_palette(), invlaid_bit_count);
+  }
+
+  // The palette follows the info header, so it starts in the extra bytes unless the info header
+  // is shorter than BITMAPINFOHEADER
+  bool bitmap_header::has_gray_palette() const noexcept {
+    const std::span header_view{header_info};
+    const auto info_size = get_value<int32_t>(header_view, info_size_offset);
+    const auto colors_used = get_value<int32_t>(header_view, colors_used_offset);
+    if (info_size < info_header_size or (colors_used != 0 and colors_used != palette_levels)) {
+      return false;
+    }
+    const long start = long{file_header_size} + info_size - header_size;
+    if (start + long{palette_levels} * palette_entry_size > std::ssize(extra_buffer)) {
+      return false;
+    }
+    for (int level = 0; level < palette_levels; ++level) {
+      const auto entry = std::span{extra_buffer}.subspan(
+          static_cast<std::size_t>(start + level * palette_entry_size), num_palette_channels);
+      const auto is_level = [level](char c) { return static_cast<uint8_t>(c) == level; };
+      if (!std::ranges::all_of(entry, is_level)) { return false; }
+    }
+    return true;
+  }
+
+  bitmap_header bitmap_header::gray_palette() const {
+    bitmap_header gray{*this};
+    gray.bit_count_ = gray_bit_count;
+    gray.extra_size_ = palette_levels * palette_entry_size;
+    gray.pixel_start_ = header_size + gray.extra_size_;
+    gray.extra_buffer.assign(static_cast<std::size_t>(gray.extra_size_), 0);
+    for (int level = 0; level < palette_levels; ++level) {
+      // Blue, green, red and a reserved byte
+      const auto entry = std::span{gray.extra_buffer}.subspan(
+          static_cast<std::size_t>(level * palette_entry_size), num_palette_channels);
+      std::ranges::fill(entry, static_cast<char>(level));
+    }
+    const auto image_bytes = static_cast<int32_t>(gray.row_stride() * std::max(0, height_));
+    const std::span header_view{gray.header_info};
+    set_value(static_cast<int32_t>(gray.pixel_start_) + image_bytes, header_view,
+        file_size_offset);
+    set_value(static_cast<int32_t>(gray.pixel_start_), header_view, pixel_start_offset);
+    set_value(info_header_size, header_view, info_size_offset);
+    set_value(static_cast<uint16_t>(gray.bit_count_), header_view, bit_count_offset);
+    set_value(image_bytes, header_view, image_size_offset);
+    set_value(int32_t{palette_levels}, header_view, colors_used_offset);
+    return gray;
+  }
+
+  bitmap_header bitmap_header::true_color() const {
+    bitmap_header color{*this};
+    color.bit_count_ = default_bit_count;
+    color.extra_size_ = 0;
+    color.pixel_start_ = header_size;
+    color.extra_buffer.clear();
+    const auto image_bytes = static_cast<int32_t>(color.row_stride() * std::max(0, height_));
+    const std::span header_view{color.header_info};
+    set_value(static_cast<int32_t>(color.pixel_start_) + image_bytes, header_view,
+        file_size_offset);
+    set_value(static_cast<int32_t>(color.pixel_start_), header_view, pixel_start_offset);
+    set_value(info_header_size, header_view, info_size_offset);
+    set_value(static_cast<uint16_t>(color.bit_count_), header_view, bit_count_offset);
+    set_value(image_bytes, header_view, image_size_offset);
+    set_value(int32_t{0}, header_view, colors_used_offset);
+    return color;
   }
 
   void bitmap_header::write(std::ostream & os) const {
@@ -29,14 +29,39 @@ namespace images::common {
       return static_cast<long>(width_) * static_cast<long>(height_);
     }
 
+    // Bytes of pixel data in one row, without the padding to a multiple of 4
+    [[nodiscard]] int row_bytes() const noexcept { return width_ * (bit_count_ / bits_per_byte); }
+
+    [[nodiscard]] int row_padding() const noexcept { return (4 - row_bytes() % 4) % 4; }
+
+    // Bytes that one row takes in the file, padding included
+    [[nodiscard]] int row_stride() const noexcept { return row_bytes() + row_padding(); }
+
+    [[nodiscard]] unsigned int pixel_start() const noexcept { return pixel_start_; }
+
+    // Header of the same image stored with 8 bits per pixel, indexing a palette of the 256 gray
+    // levels that replaces any extended header
+    [[nodiscard]] bitmap_header gray_palette() const;
+
+    // Whether pixels are 8-bit indices into the gray palette rather than BGR triplets
+    [[nodiscard]] bool is_gray_palette() const noexcept { return bit_count_ == gray_bit_count; }
+
+    // Header of the same image stored with 24 bits per pixel and no palette, the inverse of
+    // gray_palette
+    [[nodiscard]] bitmap_header true_color() const;
+
     friend void print_diff(const bitmap_header & h1, const bitmap_header & h2) noexcept;
 
   private:
     void read_buffer(std::istream & is);
     void write_buffer(std::ostream & os) const;
+    // Whether the extra bytes hold the palette that gray_palette writes
+    [[nodiscard]] bool has_gray_palette() const noexcept;
 
     static constexpr int header_size = 54;
+    static constexpr int bits_per_byte = 8;
     static constexpr int default_bit_count = 24;
+    static constexpr int gray_bit_count = 8;
     std::array<uint8_t, header_size> header_info{};
     std::vector<char> extra_buffer{};
 
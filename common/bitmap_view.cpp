@@ -0,0 +1,129 @@
+#include "bitmap_view.hpp"
+#include "file_error.hpp"
+#include "file_descriptor.hpp"
+#include "planar.hpp"
+
+#include <fcntl.h>
+#include <fstream>
+#include <omp.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+namespace images::common {
+
+  bitmap_view::bitmap_view(bitmap_view && other) noexcept: header{std::move(other.header)},
+      mapping{std::exchange(other.mapping, nullptr)},
+      mapping_size{std::exchange(other.mapping_size, 0)} {
+  }
+
+  bitmap_view & bitmap_view::operator=(bitmap_view && other) noexcept {
+    if (this != &other) {
+      unmap();
+      header = std::move(other.header);
+      mapping = std::exchange(other.mapping, nullptr);
+      mapping_size = std::exchange(other.mapping_size, 0);
+    }
+    return *this;
+  }
+
+  bitmap_view::~bitmap_view() {
+    unmap();
+  }
+
+  void bitmap_view::unmap() noexcept {
+    if (mapping != nullptr) {
+      // NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast)
+      ::munmap(const_cast<uint8_t *>(mapping), mapping_size);
+      mapping = nullptr;
+      mapping_size = 0;
+    }
+  }
+
+  void bitmap_view::read(const std::filesystem::path & in_name) {
+    std::ifstream in{in_name};
+    if (!in) {
+      throw file_error{file_error_kind::cannot_open};
+    }
+    bitmap_header new_header;
+    new_header.read(in);
+
+    const file_descriptor fd{::open(in_name.c_str(), O_RDONLY)};
+    struct stat info{};
+    if (fd.get() < 0 or ::fstat(fd.get(), &info) != 0) {
+      throw file_error{file_error_kind::cannot_open};
+    }
+    const auto file_size = static_cast<std::size_t>(info.st_size);
+    const long rows = std::max(0, new_header.height());
+    const auto pixels_end = new_header.pixel_start() +
+                            (rows > 0 ? (rows - 1) * new_header.row_stride() + new_header.row_bytes()
+                                      : 0);
+    if (file_size < static_cast<std::size_t>(pixels_end)) {
+      throw file_error{file_error_kind::cannot_read_pixels};
+    }
+    void * address = ::mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd.get(), 0);
+    if (address == MAP_FAILED) {
+      throw file_error{file_error_kind::cannot_open};
+    }
+    // Rows are scanned once, in file order, so the kernel can read ahead and drop pages behind
+    // the scan. The advice is only a hint; the view works the same if it is refused.
+    static_cast<void>(::madvise(address, file_size, MADV_SEQUENTIAL));
+    unmap();
+    header = std::move(new_header);
+    mapping = static_cast<const uint8_t *>(address);
+    mapping_size = file_size;
+  }
+
+  std::span<const uint8_t> bitmap_view::row(int r) const noexcept {
+    const std::size_t offset = header.pixel_start() +
+                               static_cast<std::size_t>(r) * static_cast<std::size_t>(header.row_stride());
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    return {mapping + offset, static_cast<std::size_t>(header.row_bytes())};
+  }
+
+  pixel bitmap_view::get_pixel(int r, int c) const noexcept {
+    if (header.is_gray_palette()) {
+      const uint8_t level = row(r)[static_cast<std::size_t>(c)];
+      return {level, level, level};
+    }
+    const auto bgr = row(r).subspan(static_cast<std::size_t>(c) * num_channels, num_channels);
+    return {bgr[red_channel], bgr[green_channel], bgr[blue_channel]};
+  }
+
+  bool bitmap_view::is_gray() const noexcept {
+    if (header.is_gray_palette()) { return true; }
+    for (int r = 0; r < height(); ++r) {
+      if (!is_gray_bgr(row(r))) { return false; }
+    }
+    return true;
+  }
+
+  // Gray rows, found by a scan that stops at the first colour pixel, only have one channel
+  // counted; those counts go to all three channels once merged. Rows of a gray palette file are
+  // counted as gray rows straight away.
+  histogram bitmap_view::generate_histogram() const noexcept {
+    const int rows = height();
+    const bool palettized = header.is_gray_palette();
+    histogram_counters counters;
+#pragma omp parallel for schedule(runtime) default(none) shared(rows, palettized, counters)
+    for (int r = 0; r < rows; ++r) {
+      const auto bgr = row(r);
+      if (palettized) {
+        counters.count_gray(omp_get_thread_num(), bgr);
+      }
+      else if (is_gray_bgr(bgr)) {
+        counters.count_gray(omp_get_thread_num(), bgr, num_channels);
+      }
+      else {
+        counters.count_bgr(omp_get_thread_num(), bgr);
+      }
+    }
+    return counters.merge();
+  }
+
+  void bitmap_view::print_info(std::ostream & os) const noexcept {
+    header.print_info(os);
+  }
+
+}
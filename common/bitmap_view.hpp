@@ -0,0 +1,51 @@
+#ifndef IMAGES_COMMON_BITMAP_VIEW_HPP
+#define IMAGES_COMMON_BITMAP_VIEW_HPP
+
+#include "common/bitmap_header.hpp"
+#include "common/pixel.hpp"
+#include "common/histogram.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <span>
+
+namespace images::common {
+
+  // Read-only bitmap mapped from its file. Rows are exposed in place over the mapped pixel array,
+  // so loading never copies pixels into memory of its own.
+  class bitmap_view {
+  public:
+    bitmap_view() noexcept = default;
+    bitmap_view(const bitmap_view &) = delete;
+    bitmap_view(bitmap_view && other) noexcept;
+    bitmap_view & operator=(const bitmap_view &) = delete;
+    bitmap_view & operator=(bitmap_view && other) noexcept;
+    ~bitmap_view();
+
+    void read(const std::filesystem::path & in_name);
+
+    [[nodiscard]] histogram generate_histogram() const noexcept;
+    void print_info(std::ostream & os) const noexcept;
+
+    [[nodiscard]] int width() const noexcept { return header.width(); }
+
+    [[nodiscard]] int height() const noexcept { return header.height(); }
+
+    [[nodiscard]] bool is_gray() const noexcept;
+
+    // Packed BGR bytes of row r, or its gray levels in a gray palette file, without padding
+    [[nodiscard]] std::span<const uint8_t> row(int r) const noexcept;
+
+    [[nodiscard]] pixel get_pixel(int r, int c) const noexcept;
+
+  private:
+    void unmap() noexcept;
+
+    bitmap_header header{};
+    const uint8_t * mapping = nullptr;
+    std::size_t mapping_size = 0;
+  };
+
+}
+
+#endif //IMAGES_COMMON_BITMAP_VIEW_HPP
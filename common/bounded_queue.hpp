@@ -0,0 +1,55 @@
+#ifndef IMAGES_COMMON_BOUNDED_QUEUE_HPP
+#define IMAGES_COMMON_BOUNDED_QUEUE_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <optional>
+
+namespace images::common {
+
+  // Queue between two pipeline stages. push blocks while the queue is full, so a fast producer
+  // never gets more than capacity items ahead of its consumer.
+  template<typename T>
+  class bounded_queue {
+  public:
+    explicit bounded_queue(std::size_t capacity) noexcept: capacity_{capacity} { }
+
+    void push(T value) {
+      std::unique_lock lock{mutex};
+      not_full.wait(lock, [this] { return items.size() < capacity_; });
+      items.push_back(std::move(value));
+      not_empty.notify_one();
+    }
+
+    // Next item, or nothing once the queue is closed and drained
+    std::optional<T> pop() {
+      std::unique_lock lock{mutex};
+      not_empty.wait(lock, [this] { return !items.empty() or closed; });
+      if (items.empty()) { return std::nullopt; }
+      std::optional<T> value{std::move(items.front())};
+      items.pop_front();
+      not_full.notify_one();
+      return value;
+    }
+
+    // No more items will be pushed
+    void close() {
+      const std::lock_guard lock{mutex};
+      closed = true;
+      not_empty.notify_all();
+    }
+
+  private:
+    std::size_t capacity_;
+    std::deque<T> items;
+    bool closed = false;
+    std::mutex mutex;
+    std::condition_variable not_full;
+    std::condition_variable not_empty;
+  };
+
+}
+
+#endif //IMAGES_COMMON_BOUNDED_QUEUE_HPP
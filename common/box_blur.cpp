@@ -0,0 +1,144 @@
+#include "box_blur.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <omp.h>
+#include <vector>
+
+namespace {
+
+  // Columns blurred together by one thread in the vertical passes: at most max_column_block,
+  // and a multiple of column_block_granularity
+  constexpr int max_column_block = 256;
+  constexpr int column_block_granularity = 64;
+
+  // Widest block that still leaves every thread a block of columns
+  int column_block(int row_length, int threads) noexcept {
+    const int per_thread = row_length / std::max(1, threads);
+    return std::clamp(per_thread / column_block_granularity * column_block_granularity,
+        column_block_granularity, max_column_block);
+  }
+
+  // Rounded mean of a sum over taps values
+  int mean(int sum, int taps) noexcept { return (sum + taps / 2) / taps; }
+
+  // NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+  // Blurs count values stride bytes apart in place. A value leaves the running sum radius + 1
+  // positions after it was overwritten, so the ring keeps the last radius + 1 originals.
+  void blur_line(uint8_t * x, int count, int stride, int radius, uint8_t * ring) noexcept {
+    int sum = 0;
+    for (int i = 0; i <= std::min(radius, count - 1); ++i) { sum += x[i * stride]; }
+    int slot = 0;
+    for (int j = 0; j < count; ++j) {
+      const int taps = std::min(j + radius, count - 1) - std::max(j - radius, 0) + 1;
+      ring[slot] = x[j * stride];
+      x[j * stride] = static_cast<uint8_t>(mean(sum, taps));
+      slot = slot == radius ? 0 : slot + 1;
+      if (j + radius + 1 < count) { sum += x[(j + radius + 1) * stride]; }
+      if (j - radius >= 0) { sum -= ring[slot]; }
+    }
+  }
+
+  // Same for width neighbouring columns at once, rows row_length bytes apart
+  void blur_columns(uint8_t * x, int rows, int row_length, int width, int radius, int * sums,
+      uint8_t * ring) noexcept {
+    std::fill(sums, sums + width, 0);
+    for (int i = 0; i <= std::min(radius, rows - 1); ++i) {
+      for (int c = 0; c < width; ++c) { sums[c] += x[i * row_length + c]; }
+    }
+    int slot = 0;
+    for (int j = 0; j < rows; ++j) {
+      const int taps = std::min(j + radius, rows - 1) - std::max(j - radius, 0) + 1;
+      uint8_t * row = x + j * row_length;
+      uint8_t * saved = ring + slot * max_column_block;
+      for (int c = 0; c < width; ++c) {
+        saved[c] = row[c];
+        row[c] = static_cast<uint8_t>(mean(sums[c], taps));
+      }
+      slot = slot == radius ? 0 : slot + 1;
+      if (j + radius + 1 < rows) {
+        const uint8_t * entering = x + (j + radius + 1) * row_length;
+        for (int c = 0; c < width; ++c) { sums[c] += entering[c]; }
+      }
+      if (j - radius >= 0) {
+        const uint8_t * leaving = ring + slot * max_column_block;
+        for (int c = 0; c < width; ++c) { sums[c] -= leaving[c]; }
+      }
+    }
+  }
+  // NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+
+  // Applies the box blurs of radii one after the other: all of them to each row while it is in
+  // cache, and then all of them to each block of columns
+  void box_blurs(std::span<uint8_t> data, int rows, int row_length, int step,
+      std::span<const int> radii) noexcept {
+    if (rows <= 0 || row_length <= 0 || radii.empty()) { return; }
+    const int widest = std::max(0, *std::ranges::max_element(radii));
+    const auto length = static_cast<std::size_t>(row_length);
+    const int block = column_block(row_length, omp_get_max_threads());
+    const int blocks = (row_length + block - 1) / block;
+
+#pragma omp parallel default(none) shared(data, rows, row_length, step, radii, widest, length, \
+    block, blocks)
+    {
+      std::vector<uint8_t> ring(static_cast<std::size_t>(widest + 1) * max_column_block);
+      std::vector<int> sums(max_column_block);
+#pragma omp for
+      for (int r = 0; r < rows; ++r) {
+        uint8_t * row = data.subspan(r * length, length).data();
+        for (const int radius: radii) {
+          if (radius <= 0) { continue; }
+          for (int c = 0; c < std::min(step, row_length); ++c) {
+            const int count = (row_length - c + step - 1) / step;
+            blur_line(std::span{row, length}.subspan(c).data(), count, step, radius, ring.data());
+          }
+        }
+      }
+#pragma omp for
+      for (int b = 0; b < blocks; ++b) {
+        const int first = b * block;
+        const int width = std::min(block, row_length - first);
+        for (const int radius: radii) {
+          if (radius <= 0) { continue; }
+          blur_columns(data.subspan(first).data(), rows, row_length, width, radius, sums.data(),
+              ring.data());
+        }
+      }
+    }
+  }
+
+}
+
+namespace images::common {
+
+  // Widths follow Kovesi's scheme: the n boxes take the two odd widths around the ideal one,
+  // w = sqrt(12 sigma^2 / n + 1), in the proportion that matches the variance 12 sigma^2.
+  std::array<int, gaussian_boxes> gaussian_box_radii(double sigma) noexcept {
+    std::array<int, gaussian_boxes> radii{};
+    if (!(sigma > 0)) { return radii; }
+    const double variance = 12 * sigma * sigma;
+    const double boxes = gaussian_boxes;
+    int lower = static_cast<int>(std::floor(std::sqrt(variance / boxes + 1)));
+    if (lower % 2 == 0) { --lower; }
+    const auto lower_count = static_cast<int>(std::lround(
+        (variance - boxes * lower * lower - 4 * boxes * lower - 3 * boxes) / (-4.0 * lower - 4)));
+    for (int i = 0; i < gaussian_boxes; ++i) {
+      const int width = i < lower_count ? lower : lower + 2;
+      radii.at(static_cast<std::size_t>(i)) = (width - 1) / 2;
+    }
+    return radii;
+  }
+
+  void box_blur(std::span<uint8_t> data, int rows, int row_length, int step, int radius)
+  noexcept {
+    const std::array radii{radius};
+    box_blurs(data, rows, row_length, step, radii);
+  }
+
+  void box_gaussian_blur(std::span<uint8_t> data, int rows, int row_length, int step,
+      double sigma) noexcept {
+    const auto radii = gaussian_box_radii(sigma);
+    box_blurs(data, rows, row_length, step, radii);
+  }
+
+}
@@ -0,0 +1,29 @@
+#ifndef IMAGES_COMMON_BOX_BLUR_HPP
+#define IMAGES_COMMON_BOX_BLUR_HPP
+
+#include <array>
+#include <cstdint>
+#include <span>
+
+namespace images::common {
+
+  // Box blurs stacked by box_gaussian_blur; three of them are within a few percent of a gaussian
+  constexpr int gaussian_boxes = 3;
+
+  // Radii of the box blurs whose succession has the variance of a gaussian of standard deviation
+  // sigma, as close as odd box widths allow
+  std::array<int, gaussian_boxes> gaussian_box_radii(double sigma) noexcept;
+
+  // Replaces each byte in place by the rounded mean of the bytes of its channel within radius
+  // rows and columns of it, over the part of that square inside the image. Rows are blurred in
+  // parallel and then blocks of columns, each with running sums, so the cost per byte does not
+  // depend on radius. Taps of one channel are step bytes apart, as in gauss_blur.
+  void box_blur(std::span<uint8_t> data, int rows, int row_length, int step, int radius) noexcept;
+
+  // Approximates a gaussian blur of standard deviation sigma pixels with stacked box blurs
+  void box_gaussian_blur(std::span<uint8_t> data, int rows, int row_length, int step,
+      double sigma) noexcept;
+
+}
+
+#endif //IMAGES_COMMON_BOX_BLUR_HPP
@@ -0,0 +1,20 @@
+#include "convolution.hpp"
+
+namespace images::common {
+
+  void apply_filter(std::span<uint8_t> data, int rows, int row_length, int step,
+      convolution_filter filter) noexcept {
+    switch (filter) {
+      case convolution_filter::box:
+        convolve<box_kernel>(data, rows, row_length, step);
+        break;
+      case convolution_filter::sharpen:
+        convolve<sharpen_kernel>(data, rows, row_length, step);
+        break;
+      case convolution_filter::emboss:
+        convolve<emboss_kernel>(data, rows, row_length, step);
+        break;
+    }
+  }
+
+}
@@ -0,0 +1,144 @@
+#ifndef IMAGES_COMMON_CONVOLUTION_HPP
+#define IMAGES_COMMON_CONVOLUTION_HPP
+
+#include "common/row_bands.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace images::common {
+
+  // Square kernel of size x size integer weights. Each result is the weighted sum divided by
+  // norm, truncated and saturated to a byte.
+  template<int size>
+  struct convolution_kernel {
+    static constexpr int width = size;
+    static constexpr int radius = size / 2;
+
+    std::array<int, static_cast<std::size_t>(size * size)> weights;
+    int norm;
+  };
+
+  constexpr convolution_kernel<3> box_kernel{{1, 1, 1, 1, 1, 1, 1, 1, 1}, 9};
+
+  constexpr convolution_kernel<3> sharpen_kernel{{0, -1, 0, -1, 5, -1, 0, -1, 0}, 1};
+
+  constexpr convolution_kernel<3> emboss_kernel{{-2, -1, 0, -1, 1, 1, 0, 1, 2}, 1};
+
+  // Same weights as gauss_blur, which runs its separable implementation through the same bands
+  constexpr convolution_kernel<5> gauss_kernel{
+      {1, 4, 7, 4, 1, 4, 16, 26, 16, 4, 7, 26, 41, 26, 7, 4, 16, 26, 16, 4, 1, 4, 7, 4, 1}, 273};
+
+  namespace detail {
+
+    template<auto kernel>
+    using kernel_window = std::array<const uint8_t *, kernel.width>;
+
+    template<auto kernel>
+    uint8_t saturate(int sum) noexcept {
+      return static_cast<uint8_t>(std::clamp(sum / kernel.norm, 0, UINT8_MAX));
+    }
+
+    // NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    // Taps of column j when all of them are inside the row. The fold is unrolled over the
+    // kernel, and taps whose weight is zero fold away.
+    template<auto kernel, std::size_t... k>
+    int interior_sum(const kernel_window<kernel> & window, int j, int step,
+        std::index_sequence<k...> /*taps*/) noexcept {
+      constexpr auto width = static_cast<std::size_t>(kernel.width);
+      return (0 + ... + (kernel.weights[k] *
+                         window[k / width][j + (static_cast<int>(k % width) - kernel.radius) *
+                                               step]));
+    }
+
+    template<auto kernel>
+    int checked_sum(const kernel_window<kernel> & window, int j, int row_length, int step)
+    noexcept {
+      int sum = 0;
+      for (int i = 0; i < kernel.width; ++i) {
+        for (int k = 0; k < kernel.width; ++k) {
+          const int c = j + (k - kernel.radius) * step;
+          if (c < 0 || c >= row_length) { continue; }
+          sum += kernel.weights.at(static_cast<std::size_t>(i * kernel.width + k)) *
+                 window.at(static_cast<std::size_t>(i))[c];
+        }
+      }
+      return sum;
+    }
+    // NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+
+    // Copies of rows, one slot per row
+    class row_copies {
+    public:
+      row_copies(int slots, std::size_t length) :
+          length_{length}, rows(static_cast<std::size_t>(slots) * length) { }
+
+      const uint8_t * hold(int slot, std::span<const uint8_t> row) noexcept {
+        const auto copy =
+            std::span{rows}.subspan(static_cast<std::size_t>(slot) * length_, length_);
+        std::ranges::copy(row, copy.begin());
+        return copy.data();
+      }
+
+    private:
+      std::size_t length_;
+      std::vector<uint8_t> rows;
+    };
+
+    template<auto kernel>
+    void convolve_row(const kernel_window<kernel> & window, std::span<uint8_t> out, int step)
+    noexcept {
+      const auto row_length = static_cast<int>(out.size());
+      const int first = std::min(kernel.radius * step, row_length);
+      const int last = std::max(first, row_length - kernel.radius * step);
+      constexpr auto taps = std::make_index_sequence<kernel.weights.size()>{};
+      for (int j = 0; j < first; ++j) {
+        out[j] = saturate<kernel>(checked_sum<kernel>(window, j, row_length, step));
+      }
+      for (int j = first; j < last; ++j) {
+        out[j] = saturate<kernel>(interior_sum<kernel>(window, j, step, taps));
+      }
+      for (int j = last; j < row_length; ++j) {
+        out[j] = saturate<kernel>(checked_sum<kernel>(window, j, row_length, step));
+      }
+    }
+
+  }
+
+  // Applies kernel in place to an image stored as consecutive rows of bytes, with taps of one
+  // channel step bytes apart. Rows go through process_in_bands, as in gauss_blur, prepared by a
+  // plain copy.
+  template<auto kernel>
+  void convolve(std::span<uint8_t> data, int rows, int row_length, int step) noexcept {
+    if (rows <= 0 || row_length <= 0) { return; }
+    const auto length = static_cast<std::size_t>(row_length);
+    const std::vector<uint8_t> zero_row(length);
+    const auto source_row = [&](int r) { return data.subspan(r * length, length); };
+    process_in_bands<kernel.width>(rows, static_cast<const uint8_t *>(zero_row.data()),
+        [&](int slots) { return detail::row_copies{slots, length}; },
+        [&](detail::row_copies & slots, int slot, int r) {
+          return slots.hold(slot, source_row(r));
+        },
+        [&](int r, const detail::kernel_window<kernel> & window) {
+          detail::convolve_row<kernel>(window, source_row(r), step);
+        });
+  }
+
+  // Filters with a kernel of their own, for the subcommands of the same name
+  enum class convolution_filter {
+    box,
+    sharpen,
+    emboss
+  };
+
+  // Runs convolve with the kernel of filter
+  void apply_filter(std::span<uint8_t> data, int rows, int row_length, int step,
+      convolution_filter filter) noexcept;
+
+}
+
+#endif //IMAGES_COMMON_CONVOLUTION_HPP
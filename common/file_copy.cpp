@@ -0,0 +1,90 @@
+#include "file_copy.hpp"
+#include "bitmap_header.hpp"
+#include "file_error.hpp"
+#include "file_descriptor.hpp"
+
+#include <algorithm>
+#include <fcntl.h>
+#include <fstream>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+  using images::common::file_error;
+  using images::common::file_error_kind;
+
+  bool clone_file(int in_fd, int out_fd) noexcept {
+    return ::ioctl(out_fd, FICLONE, in_fd) == 0;
+  }
+
+  // Copies count bytes from the start of in_fd, falling back to sendfile where copy_file_range
+  // cannot be used across the two filesystems
+  void copy_range(int in_fd, int out_fd, off_t count) {
+    off_t copied = 0;
+    while (copied < count) {
+      const auto done = ::copy_file_range(in_fd, nullptr, out_fd, nullptr,
+          static_cast<std::size_t>(count - copied), 0);
+      if (done <= 0) { break; }
+      copied += done;
+    }
+    while (copied < count) {
+      const auto done = ::sendfile(out_fd, in_fd, &copied, static_cast<std::size_t>(count - copied));
+      if (done <= 0) {
+        throw file_error{file_error_kind::cannot_write};
+      }
+    }
+  }
+
+}
+
+namespace images::common {
+
+  void copy_bitmap(const std::filesystem::path & in_name, const std::filesystem::path & out_name) {
+    std::ifstream in{in_name};
+    if (!in) {
+      throw file_error{file_error_kind::cannot_open};
+    }
+    bitmap_header header;
+    header.read(in);
+    in.close();
+    copy_bitmap(header, in_name, out_name);
+  }
+
+  void copy_bitmap(const bitmap_header & header, const std::filesystem::path & in_name,
+      const std::filesystem::path & out_name) {
+    const off_t rows = std::max(0, header.height());
+    const off_t bitmap_size = header.pixel_start() + rows * header.row_stride();
+    const file_descriptor in_fd{::open(in_name.c_str(), O_RDONLY)};
+    struct stat info{};
+    if (in_fd.get() < 0 or ::fstat(in_fd.get(), &info) != 0) {
+      throw file_error{file_error_kind::cannot_open};
+    }
+    // The padding of the last row may be missing, as when loading the image
+    if (rows > 0 and info.st_size < bitmap_size - header.row_padding()) {
+      throw file_error{file_error_kind::cannot_read_pixels};
+    }
+
+    // The output is only truncated once it is known not to be the input itself, which is then
+    // left as it is
+    constexpr mode_t new_file_mode = 0666;
+    const file_descriptor out_fd{::open(out_name.c_str(), O_WRONLY | O_CREAT, new_file_mode)};
+    struct stat out_info{};
+    if (out_fd.get() < 0 or ::fstat(out_fd.get(), &out_info) != 0) {
+      throw file_error{file_error_kind::cannot_open};
+    }
+    if (out_info.st_dev == info.st_dev and out_info.st_ino == info.st_ino) { return; }
+    if (::ftruncate(out_fd.get(), 0) != 0) {
+      throw file_error{file_error_kind::cannot_write};
+    }
+    if (!clone_file(in_fd.get(), out_fd.get())) {
+      copy_range(in_fd.get(), out_fd.get(), std::min<off_t>(info.st_size, bitmap_size));
+    }
+    if (::ftruncate(out_fd.get(), bitmap_size) != 0) {
+      throw file_error{file_error_kind::cannot_write};
+    }
+  }
+}
@@ -0,0 +1,22 @@
+#ifndef IMAGES_COMMON_FILE_COPY_HPP
+#define IMAGES_COMMON_FILE_COPY_HPP
+
+#include "common/bitmap_header.hpp"
+
+#include <filesystem>
+
+namespace images::common {
+
+  // Copies a bitmap after validating its header. Pixel data never enters user space: the file is
+  // cloned where the filesystem supports reflinks, and copied with copy_file_range or sendfile
+  // otherwise. The copy is cut or zero-padded to the size the header describes. A file copied
+  // onto itself is left untouched.
+  void copy_bitmap(const std::filesystem::path & in_name, const std::filesystem::path & out_name);
+
+  // As above, with the header of in_name already read and validated
+  void copy_bitmap(const bitmap_header & header, const std::filesystem::path & in_name,
+      const std::filesystem::path & out_name);
+
+}
+
+#endif //IMAGES_COMMON_FILE_COPY_HPP
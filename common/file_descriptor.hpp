@@ -0,0 +1,28 @@
+#ifndef IMAGES_COMMON_FILE_DESCRIPTOR_HPP
+#define IMAGES_COMMON_FILE_DESCRIPTOR_HPP
+
+#include <unistd.h>
+
+namespace images::common {
+
+  // Owns a POSIX file descriptor and closes it when going out of scope
+  class file_descriptor {
+  public:
+    explicit file_descriptor(int fd) noexcept: fd_{fd} { }
+
+    file_descriptor(const file_descriptor &) = delete;
+    file_descriptor & operator=(const file_descriptor &) = delete;
+
+    ~file_descriptor() {
+      if (fd_ >= 0) { ::close(fd_); }
+    }
+
+    [[nodiscard]] int get() const noexcept { return fd_; }
+
+  private:
+    int fd_;
+  };
+
+}
+
+#endif //IMAGES_COMMON_FILE_DESCRIPTOR_HPP
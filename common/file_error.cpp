@@ -22,6 +22,8 @@ namespace images::common {
         return "Unexpected comperession level";
       case file_error_kind::invalid_pixel_start:
         return "Invalid pixel start";
+      case file_error_kind::cannot_read_pixels:
+        return "Cannot read pixel data";
       default:
         return "Unknown error";
     }
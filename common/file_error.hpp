@@ -14,7 +14,8 @@ namespace images::common {
     invalid_planes,
     invlaid_bit_count,
     invalid_compression,
-    invalid_pixel_start
+    invalid_pixel_start,
+    cannot_read_pixels
   };
 
   std::string to_string(file_error_kind error);
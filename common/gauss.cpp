@@ -0,0 +1,891 @@
+#include "gauss.hpp"
+#include "row_bands.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <omp.h>
+#include <unistd.h>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+  using images::common::finished_row;
+  using images::common::gauss_mode;
+  using images::common::row_band;
+  using images::common::simd_level;
+
+  // The 5x5 kernel (norm 273) is the outer product v v' of v = [1 4 7 4 1] (norm 289) minus a
+  // cross of corrections: 2 at the four neighbours of the centre and 8 at the centre itself.
+  // So the exact sum is the vertical v pass over horizontal v passes, minus
+  //   2 (x[r-1][c] + x[r+1][c] + x[r][c-1] + x[r][c+1]) + 8 x[r][c]
+  // and the approximate mode just leaves the corrections out.
+  constexpr std::array<int, 5> gauss_vector{1, 4, 7, 4, 1};
+  constexpr int gauss_norm = 273;
+  constexpr int approximate_norm = 289;
+  constexpr int neighbour_correction = 2;
+  constexpr int centre_correction = 8;
+
+  constexpr int gauss_width = 5;
+  constexpr int gauss_radius = gauss_width / 2;
+
+  // Rows at each end of a band that neighbouring bands read
+  constexpr int saved_per_band = 2 * gauss_radius;
+
+  // A source row together with its horizontal pass. Rows outside the image are all zeros.
+  struct prepared_row {
+    const uint8_t * source;
+    const uint16_t * horizontal;
+  };
+
+  using row_window = std::array<prepared_row, gauss_width>;
+
+  // Columns j with margin <= j < row_length - margin have all their taps inside the row, so
+  // only the columns outside that interior are bounds checked
+  struct interior {
+    int first;
+    int last;
+  };
+
+  interior interior_columns(int row_length, int margin) noexcept {
+    const int first = std::min(margin, row_length);
+    return {first, std::max(first, row_length - margin)};
+  }
+
+#if defined(__x86_64__) || defined(__i386__)
+
+  // Vector kernels divide through floats: (sum + 0.5) / norm truncates to the integer quotient
+  // for every sum up to 255 * norm, which was checked exhaustively for both norms
+  constexpr float rounding_offset = 0.5F;
+
+  float reciprocal(gauss_mode mode) noexcept {
+    return 1.0F / static_cast<float>(mode == gauss_mode::exact ? gauss_norm : approximate_norm);
+  }
+
+  // NOLINTBEGIN(cppcoreguidelines-pro-type-reinterpret-cast,cppcoreguidelines-pro-bounds-pointer-arithmetic)
+  [[gnu::target("sse4.1")]] inline __m128i widen8_sse4(const uint8_t * p) noexcept {
+    return _mm_cvtepu8_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(p)));
+  }
+
+  // a + 4 b + 7 c on 16-bit lanes
+  [[gnu::target("sse4.1")]] inline __m128i weigh_sse4(__m128i a, __m128i b, __m128i c) noexcept {
+    return _mm_add_epi16(_mm_add_epi16(a, _mm_slli_epi16(b, 2)),
+        _mm_sub_epi16(_mm_slli_epi16(c, 3), c));
+  }
+
+  [[gnu::target("sse4.1")]] inline __m128i weigh32_sse4(__m128i a, __m128i b, __m128i c) noexcept {
+    return _mm_add_epi32(_mm_add_epi32(a, _mm_slli_epi32(b, 2)),
+        _mm_sub_epi32(_mm_slli_epi32(c, 3), c));
+  }
+
+  [[gnu::target("sse4.1")]] inline __m128i divide_sse4(__m128i sum, __m128 scale) noexcept {
+    return _mm_cvttps_epi32(
+        _mm_mul_ps(_mm_add_ps(_mm_cvtepi32_ps(sum), _mm_set1_ps(rounding_offset)), scale));
+  }
+
+  [[gnu::target("sse4.1")]]
+  int horizontal_sse4(const uint8_t * x, uint16_t * h, int first, int last, int step) noexcept {
+    constexpr int block = 8;
+    int j = first;
+    for (; j + block <= last; j += block) {
+      const __m128i outer = _mm_add_epi16(widen8_sse4(x + j - 2 * step),
+          widen8_sse4(x + j + 2 * step));
+      const __m128i inner = _mm_add_epi16(widen8_sse4(x + j - step), widen8_sse4(x + j + step));
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(h + j),
+          weigh_sse4(outer, inner, widen8_sse4(x + j)));
+    }
+    return j;
+  }
+
+  [[gnu::target("sse4.1")]]
+  int vertical_sse4(const row_window & window, uint8_t * out, int first, int last, int step,
+      gauss_mode mode) noexcept {
+    constexpr int block = 8;
+    const __m128 scale = _mm_set1_ps(reciprocal(mode));
+    const auto load = [](const uint16_t * p) {
+      return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+    };
+    const uint8_t * centre = window[2].source;
+    int j = first;
+    for (; j + block <= last; j += block) {
+      const __m128i outer = _mm_add_epi16(load(window[0].horizontal + j),
+          load(window[4].horizontal + j));
+      const __m128i inner = _mm_add_epi16(load(window[1].horizontal + j),
+          load(window[3].horizontal + j));
+      const __m128i middle = load(window[2].horizontal + j);
+      // Sums reach 17 * 4335, so the vertical pass widens to 32-bit lanes
+      const __m128i zero = _mm_setzero_si128();
+      __m128i low = weigh32_sse4(_mm_unpacklo_epi16(outer, zero), _mm_unpacklo_epi16(inner, zero),
+          _mm_unpacklo_epi16(middle, zero));
+      __m128i high = weigh32_sse4(_mm_unpackhi_epi16(outer, zero),
+          _mm_unpackhi_epi16(inner, zero), _mm_unpackhi_epi16(middle, zero));
+      if (mode == gauss_mode::exact) {
+        const __m128i neighbours = _mm_add_epi16(
+            _mm_add_epi16(widen8_sse4(window[1].source + j), widen8_sse4(window[3].source + j)),
+            _mm_add_epi16(widen8_sse4(centre + j - step), widen8_sse4(centre + j + step)));
+        const __m128i correction = _mm_add_epi16(_mm_slli_epi16(neighbours, 1),
+            _mm_slli_epi16(widen8_sse4(centre + j), 3));
+        low = _mm_sub_epi32(low, _mm_unpacklo_epi16(correction, zero));
+        high = _mm_sub_epi32(high, _mm_unpackhi_epi16(correction, zero));
+      }
+      const __m128i words = _mm_packus_epi32(divide_sse4(low, scale), divide_sse4(high, scale));
+      _mm_storel_epi64(reinterpret_cast<__m128i *>(out + j), _mm_packus_epi16(words, words));
+    }
+    return j;
+  }
+
+  [[gnu::target("avx2")]] inline __m256i load16_avx2(const uint16_t * p) noexcept {
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+  }
+
+  [[gnu::target("avx2")]] inline __m256i widen16_avx2(const uint8_t * p) noexcept {
+    return _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p)));
+  }
+
+  [[gnu::target("avx2")]] inline __m256i weigh_avx2(__m256i a, __m256i b, __m256i c) noexcept {
+    return _mm256_add_epi16(_mm256_add_epi16(a, _mm256_slli_epi16(b, 2)),
+        _mm256_sub_epi16(_mm256_slli_epi16(c, 3), c));
+  }
+
+  [[gnu::target("avx2")]] inline __m256i weigh32_avx2(__m256i a, __m256i b, __m256i c) noexcept {
+    return _mm256_add_epi32(_mm256_add_epi32(a, _mm256_slli_epi32(b, 2)),
+        _mm256_sub_epi32(_mm256_slli_epi32(c, 3), c));
+  }
+
+  [[gnu::target("avx2")]] inline __m256i divide_avx2(__m256i sum, __m256 scale) noexcept {
+    return _mm256_cvttps_epi32(_mm256_mul_ps(
+        _mm256_add_ps(_mm256_cvtepi32_ps(sum), _mm256_set1_ps(rounding_offset)), scale));
+  }
+
+  [[gnu::target("avx2")]] inline __m256i low32_avx2(__m256i v) noexcept {
+    return _mm256_cvtepu16_epi32(_mm256_castsi256_si128(v));
+  }
+
+  [[gnu::target("avx2")]] inline __m256i high32_avx2(__m256i v) noexcept {
+    return _mm256_cvtepu16_epi32(_mm256_extracti128_si256(v, 1));
+  }
+
+  [[gnu::target("avx2")]]
+  int horizontal_avx2(const uint8_t * x, uint16_t * h, int first, int last, int step) noexcept {
+    constexpr int block = 16;
+    int j = first;
+    for (; j + block <= last; j += block) {
+      const __m256i outer = _mm256_add_epi16(widen16_avx2(x + j - 2 * step),
+          widen16_avx2(x + j + 2 * step));
+      const __m256i inner = _mm256_add_epi16(widen16_avx2(x + j - step),
+          widen16_avx2(x + j + step));
+      _mm256_storeu_si256(reinterpret_cast<__m256i *>(h + j),
+          weigh_avx2(outer, inner, widen16_avx2(x + j)));
+    }
+    return j;
+  }
+
+  [[gnu::target("avx2")]]
+  int vertical_avx2(const row_window & window, uint8_t * out, int first, int last, int step,
+      gauss_mode mode) noexcept {
+    constexpr int block = 16;
+    const __m256 scale = _mm256_set1_ps(reciprocal(mode));
+    const uint8_t * centre = window[2].source;
+    int j = first;
+    for (; j + block <= last; j += block) {
+      const __m256i outer = _mm256_add_epi16(load16_avx2(window[0].horizontal + j),
+          load16_avx2(window[4].horizontal + j));
+      const __m256i inner = _mm256_add_epi16(load16_avx2(window[1].horizontal + j),
+          load16_avx2(window[3].horizontal + j));
+      const __m256i middle = load16_avx2(window[2].horizontal + j);
+      __m256i low = weigh32_avx2(low32_avx2(outer), low32_avx2(inner), low32_avx2(middle));
+      __m256i high = weigh32_avx2(high32_avx2(outer), high32_avx2(inner), high32_avx2(middle));
+      if (mode == gauss_mode::exact) {
+        const __m256i neighbours = _mm256_add_epi16(
+            _mm256_add_epi16(widen16_avx2(window[1].source + j),
+                widen16_avx2(window[3].source + j)),
+            _mm256_add_epi16(widen16_avx2(centre + j - step), widen16_avx2(centre + j + step)));
+        const __m256i correction = _mm256_add_epi16(_mm256_slli_epi16(neighbours, 1),
+            _mm256_slli_epi16(widen16_avx2(centre + j), 3));
+        low = _mm256_sub_epi32(low, low32_avx2(correction));
+        high = _mm256_sub_epi32(high, high32_avx2(correction));
+      }
+      // Packing works within 128-bit lanes, so the quarters are put back in order afterwards
+      const __m256i words = _mm256_permute4x64_epi64(
+          _mm256_packus_epi32(divide_avx2(low, scale), divide_avx2(high, scale)), 0xD8);
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(out + j),
+          _mm_packus_epi16(_mm256_castsi256_si128(words), _mm256_extracti128_si256(words, 1)));
+    }
+    return j;
+  }
+
+  [[gnu::target("avx512f,avx512bw")]] inline __m512i widen32_avx512(const uint8_t * p) noexcept {
+    return _mm512_cvtepu8_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(p)));
+  }
+
+  [[gnu::target("avx512f,avx512bw")]]
+  inline __m512i weigh_avx512(__m512i a, __m512i b, __m512i c) noexcept {
+    return _mm512_add_epi16(_mm512_add_epi16(a, _mm512_slli_epi16(b, 2)),
+        _mm512_sub_epi16(_mm512_slli_epi16(c, 3), c));
+  }
+
+  [[gnu::target("avx512f,avx512bw")]]
+  inline __m512i weigh32_avx512(__m512i a, __m512i b, __m512i c) noexcept {
+    return _mm512_add_epi32(_mm512_add_epi32(a, _mm512_slli_epi32(b, 2)),
+        _mm512_sub_epi32(_mm512_slli_epi32(c, 3), c));
+  }
+
+  [[gnu::target("avx512f,avx512bw")]]
+  inline __m128i divide_avx512(__m512i sum, __m512 scale) noexcept {
+    return _mm512_cvtusepi32_epi8(_mm512_cvttps_epi32(_mm512_mul_ps(
+        _mm512_add_ps(_mm512_cvtepi32_ps(sum), _mm512_set1_ps(rounding_offset)), scale)));
+  }
+
+  [[gnu::target("avx512f,avx512bw")]] inline __m512i low32_avx512(__m512i v) noexcept {
+    return _mm512_cvtepu16_epi32(_mm512_castsi512_si256(v));
+  }
+
+  [[gnu::target("avx512f,avx512bw")]] inline __m512i high32_avx512(__m512i v) noexcept {
+    return _mm512_cvtepu16_epi32(_mm512_extracti64x4_epi64(v, 1));
+  }
+
+  [[gnu::target("avx512f,avx512bw")]]
+  int horizontal_avx512(const uint8_t * x, uint16_t * h, int first, int last, int step) noexcept {
+    constexpr int block = 32;
+    int j = first;
+    for (; j + block <= last; j += block) {
+      const __m512i outer = _mm512_add_epi16(widen32_avx512(x + j - 2 * step),
+          widen32_avx512(x + j + 2 * step));
+      const __m512i inner = _mm512_add_epi16(widen32_avx512(x + j - step),
+          widen32_avx512(x + j + step));
+      _mm512_storeu_si512(h + j, weigh_avx512(outer, inner, widen32_avx512(x + j)));
+    }
+    return j;
+  }
+
+  [[gnu::target("avx512f,avx512bw")]]
+  int vertical_avx512(const row_window & window, uint8_t * out, int first, int last, int step,
+      gauss_mode mode) noexcept {
+    constexpr int block = 32;
+    constexpr int half = block / 2;
+    const __m512 scale = _mm512_set1_ps(reciprocal(mode));
+    const uint8_t * centre = window[2].source;
+    int j = first;
+    for (; j + block <= last; j += block) {
+      const __m512i outer = _mm512_add_epi16(_mm512_loadu_si512(window[0].horizontal + j),
+          _mm512_loadu_si512(window[4].horizontal + j));
+      const __m512i inner = _mm512_add_epi16(_mm512_loadu_si512(window[1].horizontal + j),
+          _mm512_loadu_si512(window[3].horizontal + j));
+      const __m512i middle = _mm512_loadu_si512(window[2].horizontal + j);
+      __m512i low = weigh32_avx512(low32_avx512(outer), low32_avx512(inner),
+          low32_avx512(middle));
+      __m512i high = weigh32_avx512(high32_avx512(outer), high32_avx512(inner),
+          high32_avx512(middle));
+      if (mode == gauss_mode::exact) {
+        const __m512i neighbours = _mm512_add_epi16(
+            _mm512_add_epi16(widen32_avx512(window[1].source + j),
+                widen32_avx512(window[3].source + j)),
+            _mm512_add_epi16(widen32_avx512(centre + j - step),
+                widen32_avx512(centre + j + step)));
+        const __m512i correction = _mm512_add_epi16(_mm512_slli_epi16(neighbours, 1),
+            _mm512_slli_epi16(widen32_avx512(centre + j), 3));
+        low = _mm512_sub_epi32(low, low32_avx512(correction));
+        high = _mm512_sub_epi32(high, high32_avx512(correction));
+      }
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(out + j), divide_avx512(low, scale));
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(out + j + half), divide_avx512(high, scale));
+    }
+    return j;
+  }
+  // NOLINTEND(cppcoreguidelines-pro-type-reinterpret-cast,cppcoreguidelines-pro-bounds-pointer-arithmetic)
+
+#endif
+
+  // Runs the widest vector kernel over columns first .. last-1 of the horizontal pass and
+  // returns the first column left for the scalar loop. Lanes load their taps from step bytes
+  // away, so packed BGR rows go through the same kernels as single channel planes.
+  int horizontal_vector([[maybe_unused]] const uint8_t * x, [[maybe_unused]] uint16_t * h,
+      int first, [[maybe_unused]] int last, [[maybe_unused]] int step,
+      [[maybe_unused]] simd_level level) noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+    switch (level) {
+      case simd_level::avx512:
+        return horizontal_avx512(x, h, first, last, step);
+      case simd_level::avx2:
+        return horizontal_avx2(x, h, first, last, step);
+      case simd_level::sse4:
+        return horizontal_sse4(x, h, first, last, step);
+      case simd_level::scalar:
+        break;
+    }
+#endif
+    return first;
+  }
+
+  // Same for the vertical pass and the division of an output row
+  int vertical_vector([[maybe_unused]] const row_window & window, [[maybe_unused]] uint8_t * out,
+      int first, [[maybe_unused]] int last, [[maybe_unused]] int step,
+      [[maybe_unused]] gauss_mode mode, [[maybe_unused]] simd_level level) noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+    switch (level) {
+      case simd_level::avx512:
+        return vertical_avx512(window, out, first, last, step, mode);
+      case simd_level::avx2:
+        return vertical_avx2(window, out, first, last, step, mode);
+      case simd_level::sse4:
+        return vertical_sse4(window, out, first, last, step, mode);
+      case simd_level::scalar:
+        break;
+    }
+#endif
+    return first;
+  }
+
+  // NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+  int horizontal_tap_checked(const uint8_t * x, int j, int row_length, int step) noexcept {
+    int accum = 0;
+    for (int k = 0; k < gauss_width; ++k) {
+      const int c = j + (k - gauss_radius) * step;
+      if (c < 0 || c >= row_length) { continue; }
+      accum += gauss_vector.at(k) * x[c];
+    }
+    return accum;
+  }
+
+  // Columns first .. last-1, whose taps must all be readable
+  void horizontal_interior(const uint8_t * x, uint16_t * h, int first, int last, int step,
+      simd_level level) noexcept {
+    for (int j = horizontal_vector(x, h, first, last, step, level); j < last; ++j) {
+      h[j] = static_cast<uint16_t>(x[j - 2 * step] + x[j + 2 * step] +
+                                   gauss_vector[1] * (x[j - step] + x[j + step]) +
+                                   gauss_vector[2] * x[j]);
+    }
+  }
+
+  void horizontal_pass(const uint8_t * x, uint16_t * h, int row_length, int step,
+      simd_level level) noexcept {
+    const auto [first, last] = interior_columns(row_length, gauss_radius * step);
+    for (int j = 0; j < first; ++j) {
+      h[j] = static_cast<uint16_t>(horizontal_tap_checked(x, j, row_length, step));
+    }
+    horizontal_interior(x, h, first, last, step, level);
+    for (int j = last; j < row_length; ++j) {
+      h[j] = static_cast<uint16_t>(horizontal_tap_checked(x, j, row_length, step));
+    }
+  }
+  // NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+
+  // Storage for prepared rows, one slot per row
+  class row_slots {
+  public:
+    row_slots(int slots, std::size_t length) : length_{length},
+        sources(static_cast<std::size_t>(slots) * length),
+        horizontals(static_cast<std::size_t>(slots) * length) { }
+
+    prepared_row prepare(int slot, const uint8_t * source_row, int step, simd_level level)
+    noexcept {
+      const auto offset = static_cast<std::size_t>(slot) * length_;
+      std::memcpy(sources.data() + offset, source_row, length_);
+      horizontal_pass(sources.data() + offset, horizontals.data() + offset,
+          static_cast<int>(length_), step, level);
+      return {sources.data() + offset, horizontals.data() + offset};
+    }
+
+    uint8_t * source(int slot) noexcept {
+      return std::span{sources}.subspan(static_cast<std::size_t>(slot) * length_, length_).data();
+    }
+
+    uint16_t * horizontal(int slot) noexcept {
+      return std::span{horizontals}.subspan(static_cast<std::size_t>(slot) * length_, length_)
+          .data();
+    }
+
+    // Passes horizontally a row already written into the slot
+    prepared_row finish(int slot, int step, simd_level level) noexcept {
+      horizontal_pass(source(slot), horizontal(slot), static_cast<int>(length_), step, level);
+      return held(slot);
+    }
+
+    prepared_row held(int slot) noexcept { return {source(slot), horizontal(slot)}; }
+
+  private:
+    std::size_t length_;
+    std::vector<uint8_t> sources;
+    std::vector<uint16_t> horizontals;
+  };
+
+  // NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+  int vertical_pass(const row_window & window, int j) noexcept {
+    return window[0].horizontal[j] + window[4].horizontal[j] +
+           gauss_vector[1] * (window[1].horizontal[j] + window[3].horizontal[j]) +
+           gauss_vector[2] * window[2].horizontal[j];
+  }
+
+  int exact_sum(const row_window & window, int j, int neighbours) noexcept {
+    return vertical_pass(window, j) -
+           neighbour_correction * (neighbours + window[1].source[j] + window[3].source[j]) -
+           centre_correction * window[2].source[j];
+  }
+
+  // Output columns first .. last-1, whose horizontal neighbours in the centre row must be readable
+  void gauss_interior(const row_window & window, uint8_t * out, int first, int last, int step,
+      gauss_mode mode, simd_level level) noexcept {
+    if (mode == gauss_mode::approximate) {
+      for (int j = vertical_vector(window, out, first, last, step, mode, level); j < last; ++j) {
+        out[j] = static_cast<uint8_t>(vertical_pass(window, j) / approximate_norm);
+      }
+      return;
+    }
+    const uint8_t * centre = window[2].source;
+    for (int j = vertical_vector(window, out, first, last, step, mode, level); j < last; ++j) {
+      out[j] = static_cast<uint8_t>(
+          exact_sum(window, j, centre[j - step] + centre[j + step]) / gauss_norm);
+    }
+  }
+
+  void gauss_row(const row_window & window, uint8_t * out, int row_length, int step,
+      gauss_mode mode, simd_level level) noexcept {
+    if (mode == gauss_mode::approximate) {
+      gauss_interior(window, out, 0, row_length, step, mode, level);
+      return;
+    }
+    const uint8_t * centre = window[2].source;
+    const auto checked = [&](int j) {
+      int neighbours = 0;
+      if (j - step >= 0) { neighbours += centre[j - step]; }
+      if (j + step < row_length) { neighbours += centre[j + step]; }
+      out[j] = static_cast<uint8_t>(exact_sum(window, j, neighbours) / gauss_norm);
+    };
+    const auto [first, last] = interior_columns(row_length, step);
+    for (int j = 0; j < first; ++j) { checked(j); }
+    gauss_interior(window, out, first, last, step, mode, level);
+    for (int j = last; j < row_length; ++j) { checked(j); }
+  }
+  // NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+
+  // Bytes of L2 cache per core, or a common size where the system does not tell
+  long l2_cache_size() noexcept {
+    constexpr long fallback = 256L * 1024;
+#ifdef _SC_LEVEL2_CACHE_SIZE
+    static const long size = sysconf(_SC_LEVEL2_CACHE_SIZE);
+    if (size > 0) { return size; }
+#endif
+    return fallback;
+  }
+
+  // Rows of a tile; its four halo rows are prepared twice, so taller tiles waste less
+  constexpr int tile_rows = 64;
+
+  // Each column of a tile keeps gauss_width source bytes and as many 16-bit horizontal sums live
+  constexpr long tile_bytes_per_column = gauss_width * (sizeof(uint8_t) + sizeof(uint16_t));
+
+  // Tile columns are kept a multiple of a cache line
+  constexpr int tile_column_granularity = 64;
+
+  // Columns first .. last-1 of a strip of tiles
+  struct column_strip {
+    int first;
+    int last;
+  };
+
+  // Strips of strip_width columns, the last one taking the remaining columns, together with a
+  // copy of the halo bytes on both sides of every boundary between strips. The copies are taken
+  // for each row before any strip is written, so every strip reads its halo from them.
+  // NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+  class column_strips {
+  public:
+    // halo may not exceed strip_width
+    column_strips(int rows, int row_length, int strip_width, int halo) :
+        rows_{rows}, row_length_{row_length}, strip_width_{strip_width},
+        count_{std::max(1, row_length / strip_width)}, halo_{halo},
+        boundaries(static_cast<std::size_t>(count_ - 1) * static_cast<std::size_t>(rows) *
+                   boundary_length()) { }
+
+    [[nodiscard]] int count() const noexcept { return count_; }
+
+    [[nodiscard]] column_strip columns(int strip) const noexcept {
+      return {strip * strip_width_, strip + 1 == count_ ? row_length_ : (strip + 1) * strip_width_};
+    }
+
+    void save(int r, const uint8_t * source_row) noexcept {
+      for (int b = 1; b < count_; ++b) {
+        std::memcpy(boundary(b, r), source_row + b * strip_width_ - halo_, boundary_length());
+      }
+    }
+
+    // Bytes halo before .. halo after boundary b, the start of strip b
+    uint8_t * boundary(int b, int r) noexcept {
+      const auto index = static_cast<std::size_t>(b - 1) * static_cast<std::size_t>(rows_) +
+                         static_cast<std::size_t>(r);
+      return std::span{boundaries}.subspan(index * boundary_length(), boundary_length()).data();
+    }
+
+  private:
+    [[nodiscard]] std::size_t boundary_length() const noexcept {
+      return static_cast<std::size_t>(2 * halo_);
+    }
+
+    int rows_;
+    int row_length_;
+    int strip_width_;
+    int count_;
+    int halo_;
+    std::vector<uint8_t> boundaries;
+  };
+  // NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+
+  struct blur_settings {
+    int rows;
+    int row_length;
+    int step;
+    gauss_mode mode;
+    simd_level level;
+  };
+
+  // Blurs one tile of rows several times over. Level k holds a ring of the rows of blur k-1
+  // (level 0 being the source), and each row pushed into a level produces the output rows whose
+  // window it completes, pushed in turn into the next level. Rows of the last blur go to emit.
+  // Blur k is computed 2 (iterations - k) rows beyond the band on each side, so no level needs
+  // rows from other bands. Columns beyond the tile count as zeros, which spoils no more than the
+  // 2 k step bytes of blur k next to a side of the tile cut from a wider image.
+  class iterated_tile {
+  public:
+    // settings.row_length is the width of the tile
+    iterated_tile(const blur_settings & settings, row_band band, int iterations) :
+        settings_{settings}, band_{band}, iterations_{iterations},
+        zero_source(static_cast<std::size_t>(settings.row_length)),
+        zero_horizontal(static_cast<std::size_t>(settings.row_length)),
+        next(static_cast<std::size_t>(iterations) + 1) {
+      const auto length = static_cast<std::size_t>(settings.row_length);
+      levels.reserve(static_cast<std::size_t>(iterations));
+      for (int k = 0; k < iterations; ++k) { levels.emplace_back(gauss_width, length); }
+      for (int k = 1; k <= iterations; ++k) { next[k] = needed(k).first; }
+    }
+
+    // Rows of blur k this band needs; blur 0 is the source
+    [[nodiscard]] row_band needed(int k) const noexcept {
+      const int margin = gauss_radius * (iterations_ - k);
+      return {std::max(0, band_.first - margin), std::min(settings_.rows, band_.last + margin)};
+    }
+
+    // Where source row r is written before push_source(r, ...)
+    uint8_t * source(int r) noexcept { return levels.front().source(r % gauss_width); }
+
+    // emit(r, window) writes row r of the last blur from its window
+    void push_source(int r, auto emit) noexcept {
+      levels.front().finish(r % gauss_width, settings_.step, settings_.level);
+      push(1, r, emit);
+    }
+
+  private:
+    // Row r of blur k-1 is in the ring of level k-1
+    void push(int k, int r, auto & emit) noexcept {
+      const auto [first, last] = needed(k);
+      const int inputs_end = needed(k - 1).last;
+      auto & ring = levels[static_cast<std::size_t>(k - 1)];
+      while (next[k] < last and std::min(next[k] + gauss_radius, inputs_end - 1) <= r) {
+        const int out = next[k]++;
+        row_window window{};
+        for (int i = 0; i < gauss_width; ++i) {
+          const int row = out + i - gauss_radius;
+          window.at(i) = row < 0 || row >= settings_.rows ? zero_row() :
+                                                            ring.held(row % gauss_width);
+        }
+        if (k == iterations_) {
+          emit(out, window);
+        }
+        else {
+          auto & following = levels[static_cast<std::size_t>(k)];
+          gauss_row(window, following.source(out % gauss_width), settings_.row_length,
+              settings_.step, settings_.mode, settings_.level);
+          following.finish(out % gauss_width, settings_.step, settings_.level);
+          push(k + 1, out, emit);
+        }
+      }
+    }
+
+    prepared_row zero_row() const noexcept { return {zero_source.data(), zero_horizontal.data()}; }
+
+    blur_settings settings_;
+    row_band band_;
+    int iterations_;
+    std::vector<uint8_t> zero_source;
+    std::vector<uint16_t> zero_horizontal;
+    std::vector<row_slots> levels;
+    // Next output row of each blur
+    std::vector<int> next;
+  };
+
+  // Blurs each of planes iterations times. The planes are cut into bands and strips as in
+  // gauss_blur_tiled, except that bands and halos reach 2 iterations rows and columns (of step
+  // bytes) beyond each tile; a strip only takes halo columns towards the other strips. Every tile
+  // then streams its source rows once through all the blurs, and the last blur writes the tile's
+  // own columns back to its plane. Threads take tiles from the runtime schedule, band after band
+  // and plane after plane within a band, and the thread finishing the last tile of a band reports
+  // its rows.
+  // NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+  void blur_iterated_tiles(std::span<const std::span<uint8_t>> planes, int rows, int row_length,
+      int step, int iterations, images::common::gauss_tile tile, gauss_mode mode,
+      simd_level level, const finished_row & on_row) noexcept {
+    using images::common::even_band;
+    const int reach = gauss_radius * iterations;
+    const int halo = reach * step;
+    const int bands = std::min(images::common::band_count(rows, 2 * reach),
+        std::max(1, rows / std::max(1, tile.rows)));
+    const auto length = static_cast<std::size_t>(row_length);
+    const auto plane_count = static_cast<int>(planes.size());
+    std::vector strips(planes.size(),
+        column_strips{rows, row_length, std::max({tile.columns, halo, 1}), halo});
+    const int strip_count = strips.front().count();
+    const int band_tiles = plane_count * strip_count;
+    const std::size_t saved_per_plane =
+        static_cast<std::size_t>(bands) * 2 * static_cast<std::size_t>(reach) * length;
+    std::vector<uint8_t> saved(planes.size() * saved_per_plane);
+    std::vector<const uint8_t *> saved_rows(planes.size() * static_cast<std::size_t>(rows));
+    std::vector<std::atomic<int>> tiles_done(static_cast<std::size_t>(bands));
+
+#pragma omp parallel default(none) \
+    shared(planes, rows, step, iterations, mode, level, on_row, reach, halo, bands, length, \
+        plane_count, strips, strip_count, band_tiles, saved_per_plane, saved, saved_rows, \
+        tiles_done)
+    {
+      const auto source_row = [&](int p, int r) {
+        return planes[p].subspan(r * length, length).data();
+      };
+      const auto saved_row = [&](int p, int r) -> const uint8_t *& {
+        return saved_rows[static_cast<std::size_t>(p) * static_cast<std::size_t>(rows) +
+                          static_cast<std::size_t>(r)];
+      };
+
+#pragma omp for
+      for (int b = 0; b < bands; ++b) {
+        const auto band = even_band(rows, b, bands);
+        for (int p = 0; p < plane_count; ++p) {
+          std::size_t slot = static_cast<std::size_t>(b) * 2 * static_cast<std::size_t>(reach);
+          const auto plane_saved = std::span{saved}.subspan(p * saved_per_plane, saved_per_plane);
+          for (int r = band.first; r < band.last; ++r) {
+            if (r < band.first + reach || r >= band.last - reach) {
+              uint8_t * copy = plane_saved.subspan(slot++ * length, length).data();
+              std::memcpy(copy, source_row(p, r), length);
+              saved_row(p, r) = copy;
+            }
+          }
+        }
+      }
+#pragma omp for
+      for (int r = 0; r < rows; ++r) {
+        for (int p = 0; p < plane_count; ++p) { strips[p].save(r, source_row(p, r)); }
+      }
+
+#pragma omp for schedule(runtime)
+      for (int t = 0; t < bands * band_tiles; ++t) {
+        const auto band = even_band(rows, t / band_tiles, bands);
+        const int p = t % band_tiles / strip_count;
+        const int strip = t % strip_count;
+        const auto [left, right] = strips[p].columns(strip);
+        const int before = strip == 0 ? 0 : halo;
+        const int after = strip + 1 == strip_count ? 0 : halo;
+        const int width = before + right - left + after;
+        iterated_tile blur{{rows, width, step, mode, level}, band, iterations};
+        // A single tile as wide as the image is blurred straight into it
+        const bool in_place = band_tiles == 1;
+        std::vector<uint8_t> blurred(in_place ? 0 : static_cast<std::size_t>(width));
+        const auto emit = [&](int r, const row_window & window) {
+          if (in_place) {
+            gauss_row(window, source_row(p, r), width, step, mode, level);
+            if (on_row) { on_row(r); }
+            return;
+          }
+          gauss_row(window, blurred.data(), width, step, mode, level);
+          std::memcpy(source_row(p, r) + left, blurred.data() + before, right - left);
+        };
+        const auto [first, last] = blur.needed(0);
+        for (int r = first; r < last; ++r) {
+          // Rows of this tile are read from the image, the halo around them from the copies
+          uint8_t * x = blur.source(r);
+          if (r < band.first || r >= band.last) {
+            std::memcpy(x, saved_row(p, r) + left - before, width);
+          }
+          else {
+            if (before > 0) { std::memcpy(x, strips[p].boundary(strip, r), halo); }
+            std::memcpy(x + before, source_row(p, r) + left, right - left);
+            if (after > 0) {
+              std::memcpy(x + before + right - left, strips[p].boundary(strip + 1, r) + halo,
+                  halo);
+            }
+          }
+          blur.push_source(r, emit);
+        }
+        if (!in_place && on_row && tiles_done[t / band_tiles].fetch_add(1) + 1 == band_tiles) {
+          for (int r = band.first; r < band.last; ++r) { on_row(r); }
+        }
+      }
+    }
+  }
+  // NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+
+}
+
+namespace images::common {
+
+  gauss_tile default_gauss_tile(int iterations) noexcept {
+    const long columns = l2_cache_size() / 2 / tile_bytes_per_column / std::max(1, iterations);
+    return {tile_rows, static_cast<int>(std::max(1L, columns / tile_column_granularity)) *
+                       tile_column_granularity};
+  }
+
+  // Rows are blurred in place by process_in_bands, with each source row prepared (copied and
+  // passed horizontally) into its slot. Rows too wide for the ring of five prepared rows to stay
+  // in L2 are blurred in tiles instead.
+  void gauss_blur(std::span<uint8_t> data, int rows, int row_length, int step, gauss_mode mode,
+      simd_level level, const finished_row & on_row) noexcept {
+    if (rows <= 0 || row_length <= 0) { return; }
+    const gauss_tile tile = default_gauss_tile();
+    if (row_length > tile.columns) {
+      gauss_blur_tiled(data, rows, row_length, step, tile, mode, level, on_row);
+      return;
+    }
+    const auto length = static_cast<std::size_t>(row_length);
+    const std::vector<uint8_t> zero_source(length);
+    const std::vector<uint16_t> zero_horizontal(length);
+    const auto source_row = [&](int r) { return data.subspan(r * length, length).data(); };
+    process_in_bands<gauss_width>(rows, prepared_row{zero_source.data(), zero_horizontal.data()},
+        [&](int slots) { return row_slots{slots, length}; },
+        [&](row_slots & slots, int slot, int r) {
+          return slots.prepare(slot, source_row(r), step, level);
+        },
+        [&](int r, const row_window & window) {
+          gauss_row(window, source_row(r), row_length, step, mode, level);
+          if (on_row) { on_row(r); }
+        });
+  }
+
+  void gauss_blur_iterated(std::span<uint8_t> data, int rows, int row_length, int step,
+      int iterations, gauss_mode mode, simd_level level, const finished_row & on_row) noexcept {
+    if (iterations == 1) {
+      gauss_blur(data, rows, row_length, step, mode, level, on_row);
+      return;
+    }
+    gauss_blur_iterated_tiled(data, rows, row_length, step, iterations,
+        default_gauss_tile(iterations), mode, level, on_row);
+  }
+
+  void gauss_blur_iterated_tiled(std::span<uint8_t> data, int rows, int row_length, int step,
+      int iterations, gauss_tile tile, gauss_mode mode, simd_level level,
+      const finished_row & on_row) noexcept {
+    if (iterations <= 1 || rows <= 0 || row_length <= 0) {
+      if (iterations == 1) {
+        gauss_blur_tiled(data, rows, row_length, step, tile, mode, level, on_row);
+      }
+      return;
+    }
+    const std::array planes{data};
+    blur_iterated_tiles(planes, rows, row_length, step, iterations, tile, mode, level, on_row);
+  }
+
+  void gauss_blur_planes(std::span<const std::span<uint8_t>> planes, int rows, int row_length,
+      int iterations, gauss_mode mode, simd_level level, const finished_row & on_row) noexcept {
+    gauss_blur_planes_tiled(planes, rows, row_length, iterations, default_gauss_tile(iterations),
+        mode, level, on_row);
+  }
+
+  void gauss_blur_planes_tiled(std::span<const std::span<uint8_t>> planes, int rows,
+      int row_length, int iterations, gauss_tile tile, gauss_mode mode, simd_level level,
+      const finished_row & on_row) noexcept {
+    if (planes.empty() || iterations <= 0 || rows <= 0 || row_length <= 0) { return; }
+    blur_iterated_tiles(planes, rows, row_length, 1, iterations, tile, mode, level, on_row);
+  }
+
+  // The image is cut into bands of tile.rows rows and strips of tile.columns bytes; the last
+  // strip takes the remaining columns. Before any tile is written, the first and last two rows of
+  // every band and the halo bytes on both sides of every strip boundary are copied aside, so
+  // each tile reads its halo once from those copies and its own bytes from the image. Tile rows
+  // are padded with a halo of zeros at the image borders, which leaves no column to bounds check.
+  // Threads take tiles from the runtime schedule, band after band, and the thread finishing the
+  // last strip of a band reports its rows.
+  // NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+  void gauss_blur_tiled(std::span<uint8_t> data, int rows, int row_length, int step,
+      gauss_tile tile, gauss_mode mode, simd_level level, const finished_row & on_row) noexcept {
+    if (rows <= 0 || row_length <= 0) { return; }
+    const int halo = gauss_radius * step;
+    const int band_height = std::max(tile.rows, gauss_radius);
+    const int bands = (rows + band_height - 1) / band_height;
+    const auto length = static_cast<std::size_t>(row_length);
+    column_strips strips{rows, row_length, std::max({tile.columns, halo, 1}), halo};
+    const int strip_count = strips.count();
+    const auto [last_left, last_right] = strips.columns(strip_count - 1);
+    const auto padded_length = static_cast<std::size_t>(last_right - last_left + 2 * halo);
+
+    std::vector<uint8_t> saved(static_cast<std::size_t>(bands) * saved_per_band * length);
+    std::vector<const uint8_t *> saved_rows(static_cast<std::size_t>(rows));
+    const std::vector<uint8_t> zero_source(padded_length);
+    const std::vector<uint16_t> zero_horizontal(padded_length);
+    const prepared_row zero_row{zero_source.data() + halo, zero_horizontal.data() + halo};
+    std::vector<std::atomic<int>> strips_done(static_cast<std::size_t>(bands));
+
+    const auto band_rows = [&](int band) {
+      return row_band{band * band_height, std::min(rows, (band + 1) * band_height)};
+    };
+
+#pragma omp parallel default(none) \
+    shared(data, rows, row_length, step, mode, level, on_row, halo, strips, strip_count, bands, \
+        length, padded_length, saved, saved_rows, zero_row, strips_done, band_rows)
+    {
+      const auto source_row = [&](int r) { return data.subspan(r * length, length).data(); };
+
+#pragma omp for
+      for (int band = 0; band < bands; ++band) {
+        const auto [first, last] = band_rows(band);
+        int slot = band * saved_per_band;
+        for (int r = first; r < last; ++r) {
+          if (r < first + gauss_radius || r >= last - gauss_radius) {
+            uint8_t * copy = std::span{saved}.subspan(slot++ * length, length).data();
+            std::memcpy(copy, source_row(r), length);
+            saved_rows[r] = copy;
+          }
+        }
+      }
+#pragma omp for
+      for (int r = 0; r < rows; ++r) { strips.save(r, source_row(r)); }
+
+      row_slots ring{gauss_width, padded_length};
+#pragma omp for schedule(runtime)
+      for (int t = 0; t < bands * strip_count; ++t) {
+        const auto [first, last] = band_rows(t / strip_count);
+        const int strip = t % strip_count;
+        const auto [left, right] = strips.columns(strip);
+        const int width = right - left;
+        // Rows of this tile are read from the image, the halo around them from the copies
+        const auto fetch = [&](int r) -> prepared_row {
+          if (r < 0 || r >= rows) { return zero_row; }
+          const int slot = r % gauss_width;
+          uint8_t * x = ring.source(slot);
+          if (r < first || r >= last) {
+            const int begin = std::max(left - halo, 0);
+            const int end = std::min(right + halo, row_length);
+            std::memset(x, 0, padded_length);
+            std::memcpy(x + begin - (left - halo), saved_rows[r] + begin, end - begin);
+          }
+          else {
+            if (strip == 0) { std::memset(x, 0, halo); }
+            else { std::memcpy(x, strips.boundary(strip, r), halo); }
+            std::memcpy(x + halo, source_row(r) + left, width);
+            if (strip + 1 == strip_count) { std::memset(x + halo + width, 0, halo); }
+            else { std::memcpy(x + halo + width, strips.boundary(strip + 1, r) + halo, halo); }
+          }
+          uint16_t * h = ring.horizontal(slot);
+          horizontal_interior(x + halo, h + halo, 0, width, step, level);
+          return {x + halo, h + halo};
+        };
+        slide_window<gauss_width>(first, last, fetch, [&](int r, const row_window & window) {
+          gauss_interior(window, source_row(r) + left, 0, width, step, mode, level);
+        });
+        if (on_row && strips_done[t / strip_count].fetch_add(1) + 1 == strip_count) {
+          for (int r = first; r < last; ++r) { on_row(r); }
+        }
+      }
+    }
+  }
+  // NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+
+}
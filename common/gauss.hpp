@@ -0,0 +1,73 @@
+#ifndef IMAGES_COMMON_GAUSS_HPP
+#define IMAGES_COMMON_GAUSS_HPP
+
+#include "common/simd.hpp"
+
+#include <cstdint>
+#include <functional>
+#include <span>
+
+namespace images::common {
+
+  enum class gauss_mode {
+    // Bit-identical to the 5x5 kernel with norm 273
+    exact,
+    // Outer product of [1 4 7 4 1] with norm 289: horizontal and vertical passes only. Differs
+    // from the exact result by at most approximate_gauss_max_error levels per channel.
+    approximate
+  };
+
+  // Bound on |exact - approximate| for any image. The normalized kernels differ by 6.62/255 in
+  // L1 over their positive part, plus one level lost to truncating each result.
+  constexpr int approximate_gauss_max_error = 7;
+
+  // Rows and columns, in bytes, of the tiles blurred by gauss_blur_tiled
+  struct gauss_tile {
+    int rows;
+    int columns;
+  };
+
+  // Tile whose live rows, for iterations chained blurs, take about half of the L2 cache
+  gauss_tile default_gauss_tile(int iterations = 1) noexcept;
+
+  // Called with the index of each row once its blurred bytes are final. Rows finish in any order
+  // and on any thread of the team.
+  using finished_row = std::function<void(int)>;
+
+  // Applies the 5x5 gauss blur in place to an image stored as consecutive rows of bytes. Taps of
+  // one channel are step bytes apart: 1 for a plane holding a single channel, 3 for BGR rows.
+  void gauss_blur(std::span<uint8_t> data, int rows, int row_length, int step,
+      gauss_mode mode = gauss_mode::exact, simd_level level = detected_simd_level(),
+      const finished_row & on_row = {}) noexcept;
+
+  // Applies gauss_blur iterations times. The blurs are chained row by row within each band, and
+  // wide rows are cut into strips, so the image is read and written once whatever the count.
+  void gauss_blur_iterated(std::span<uint8_t> data, int rows, int row_length, int step,
+      int iterations, gauss_mode mode = gauss_mode::exact,
+      simd_level level = detected_simd_level(), const finished_row & on_row = {}) noexcept;
+
+  // Same result as gauss_blur_iterated, with strips of tile.columns bytes and bands of at least
+  // tile.rows rows
+  void gauss_blur_iterated_tiled(std::span<uint8_t> data, int rows, int row_length, int step,
+      int iterations, gauss_tile tile, gauss_mode mode = gauss_mode::exact,
+      simd_level level = detected_simd_level(), const finished_row & on_row = {}) noexcept;
+
+  // Applies gauss_blur_iterated to several single channel planes of the same size in one pass,
+  // band by band. on_row is called with each row once it is final in all of the planes.
+  void gauss_blur_planes(std::span<const std::span<uint8_t>> planes, int rows, int row_length,
+      int iterations, gauss_mode mode = gauss_mode::exact,
+      simd_level level = detected_simd_level(), const finished_row & on_row = {}) noexcept;
+
+  // Same result as gauss_blur_planes, with tiles cut as by gauss_blur_iterated_tiled
+  void gauss_blur_planes_tiled(std::span<const std::span<uint8_t>> planes, int rows,
+      int row_length, int iterations, gauss_tile tile, gauss_mode mode = gauss_mode::exact,
+      simd_level level = detected_simd_level(), const finished_row & on_row = {}) noexcept;
+
+  // Same result as gauss_blur, computed tile by tile so each tile's working rows stay in cache
+  void gauss_blur_tiled(std::span<uint8_t> data, int rows, int row_length, int step,
+      gauss_tile tile, gauss_mode mode = gauss_mode::exact,
+      simd_level level = detected_simd_level(), const finished_row & on_row = {}) noexcept;
+
+}
+
+#endif //IMAGES_COMMON_GAUSS_HPP
@@ -0,0 +1,356 @@
+#include "gray.hpp"
+#include "normalized_pixel.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <ostream>
+#include <omp.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+// GCC 12 warns about the deliberately undefined operands of the AVX-512 intrinsics at -O2
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#include <immintrin.h>
+#pragma GCC diagnostic pop
+#endif
+
+namespace {
+  using namespace images::common;
+
+  // The vector kernels compute y = 255 gamma_correction(gray) in float lanes and truncate it,
+  // with both powers approximated by polynomials. Their error on y stays below 2e-4: each
+  // polynomial is within 3.4e-7 of its power, and the float roundings on the way add less than
+  // that again. Lanes with y closer than y_margin to an integer, or with gray closer than
+  // gray_margin to gamma_threshold, might truncate differently from the double path and are left
+  // to the scalar lookup.
+  constexpr float y_margin = 1.0F / 1024;
+  constexpr float gray_margin = 1.0F / static_cast<float>(1 << 20);
+
+  constexpr int exponent_bias = 127;
+  constexpr int mantissa_bits = 23;
+  constexpr int32_t mantissa_mask = (1 << mantissa_bits) - 1;
+  constexpr int32_t one_bits = exponent_bias << mantissa_bits;
+  constexpr int power_terms = 7;
+  constexpr int power_scales = 16;
+
+  // x^a = m^a 2^(a e) for x = m 2^e with 1 <= m < 2. m^a is a degree 6 polynomial in m - 1.5,
+  // fitted at Chebyshev nodes, and 2^(a e) is looked up for the exponents of the inputs.
+  struct power_table {
+    std::array<float, power_terms> polynomial;
+    int lowest_exponent;
+    alignas(64) std::array<float, power_scales> scales{};
+
+    power_table(double exponent, std::array<float, power_terms> terms, int lowest) noexcept :
+        polynomial{terms}, lowest_exponent{lowest} {
+      for (int i = 0; i < power_scales; ++i) {
+        scales.at(i) = static_cast<float>(std::pow(2.0, std::min(lowest + i, 0) * exponent));
+      }
+    }
+  };
+
+  // x^0.4 for the intensity transform, x^2.4 = x^2 x^0.4 with x from 0.09 to 1, and g^(5/12)
+  // for the gamma correction with g from gamma_threshold to 1
+  struct gray_power_tables {
+    power_table linear{intensity_exponent - 2, {1.1760790348052979F, 0.3136236071586609F,
+        -0.06272745877504349F, 0.02222251705825329F, -0.009600535035133362F,
+        0.005252895876765251F, -0.0027627383824437857F}, -4};
+    power_table root{intensity_exponent_inv, {1.184053659439087F, 0.32890626788139343F,
+        -0.06395671516656876F, 0.022423479706048965F, -0.00962554570287466F,
+        0.00523735536262393F, -0.0027445252053439617F}, -9};
+  };
+
+  const gray_power_tables & gray_powers() noexcept {
+    static const gray_power_tables tables;
+    return tables;
+  }
+
+  constexpr auto max_level = static_cast<float>(intensity_max_value);
+  // Levels up to this one take the linear branch of the intensity transform
+  constexpr auto linear_levels = static_cast<float>(intensity_threshold * intensity_max_value);
+  constexpr auto linear_factor = static_cast<float>(1 / (intensity_max_value * intensity_divisor1));
+  constexpr auto power_factor = static_cast<float>(1 / (intensity_max_value * intensity_divisor2));
+  constexpr auto power_offset = static_cast<float>(intensity_delta / intensity_divisor2);
+  constexpr auto gray_scale = static_cast<float>(intensity_max_value * intensity_divisor1);
+  constexpr auto root_scale = static_cast<float>(intensity_max_value * intensity_divisor2);
+  constexpr auto root_offset = static_cast<float>(intensity_max_value * intensity_delta);
+
+  // NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+  void planes_to_gray_scalar(const_plane_pointers planes, uint8_t * out, std::size_t first,
+      std::size_t count) noexcept {
+    const auto & gray = gray_levels();
+    for (std::size_t p = first; p < count; ++p) {
+      out[p] = gray(planes[red_channel][p], planes[green_channel][p], planes[blue_channel][p]);
+    }
+  }
+
+  // Recomputes the lanes set in ambiguous with the scalar lookup, and stores the block of levels
+  void store_block(const_plane_pointers planes, uint8_t * out, std::size_t p, uint8_t * levels,
+      std::size_t block, unsigned ambiguous) noexcept {
+    const auto & gray = gray_levels();
+    for (; ambiguous != 0; ambiguous &= ambiguous - 1) {
+      const auto lane = static_cast<std::size_t>(std::countr_zero(ambiguous));
+      levels[lane] = gray(planes[red_channel][p + lane], planes[green_channel][p + lane],
+          planes[blue_channel][p + lane]);
+    }
+    std::memcpy(out + p, levels, block);
+  }
+  // NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+
+#if defined(__x86_64__) || defined(__i386__)
+
+  // NOLINTBEGIN(cppcoreguidelines-pro-type-reinterpret-cast,cppcoreguidelines-pro-bounds-pointer-arithmetic)
+  // x^a for positive x; lanes with exponents outside the table give garbage the callers discard
+  [[gnu::target("avx2")]] inline __m256 power_avx2(__m256 x, const power_table & power) noexcept {
+    const __m256i bits = _mm256_castps_si256(x);
+    const __m256 t = _mm256_sub_ps(_mm256_castsi256_ps(_mm256_or_si256(
+        _mm256_and_si256(bits, _mm256_set1_epi32(mantissa_mask)), _mm256_set1_epi32(one_bits))),
+        _mm256_set1_ps(1.5F));
+    const auto & c = power.polynomial;
+    __m256 result = _mm256_set1_ps(c[6]);
+    result = _mm256_add_ps(_mm256_mul_ps(result, t), _mm256_set1_ps(c[5]));
+    result = _mm256_add_ps(_mm256_mul_ps(result, t), _mm256_set1_ps(c[4]));
+    result = _mm256_add_ps(_mm256_mul_ps(result, t), _mm256_set1_ps(c[3]));
+    result = _mm256_add_ps(_mm256_mul_ps(result, t), _mm256_set1_ps(c[2]));
+    result = _mm256_add_ps(_mm256_mul_ps(result, t), _mm256_set1_ps(c[1]));
+    result = _mm256_add_ps(_mm256_mul_ps(result, t), _mm256_set1_ps(c[0]));
+    const __m256i index = _mm256_sub_epi32(_mm256_srli_epi32(bits, mantissa_bits),
+        _mm256_set1_epi32(exponent_bias + power.lowest_exponent));
+    const __m256 low = _mm256_permutevar8x32_ps(_mm256_load_ps(power.scales.data()), index);
+    const __m256 high = _mm256_permutevar8x32_ps(_mm256_load_ps(power.scales.data() + 8), index);
+    const __m256 upper = _mm256_castsi256_ps(_mm256_cmpgt_epi32(index, _mm256_set1_epi32(7)));
+    return _mm256_mul_ps(result, _mm256_blendv_ps(low, high, upper));
+  }
+
+  // Linear intensity of eight levels of one plane times coefficient
+  [[gnu::target("avx2")]]
+  inline __m256 linear_avx2(const uint8_t * p, float coefficient, const power_table & power)
+  noexcept {
+    const __m256 v = _mm256_cvtepi32_ps(
+        _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(p))));
+    const __m256 small = _mm256_mul_ps(v, _mm256_set1_ps(linear_factor));
+    const __m256 x = _mm256_add_ps(_mm256_mul_ps(v, _mm256_set1_ps(power_factor)),
+        _mm256_set1_ps(power_offset));
+    const __m256 large = _mm256_mul_ps(_mm256_mul_ps(x, x), power_avx2(x, power));
+    const __m256 linear = _mm256_blendv_ps(large, small,
+        _mm256_cmp_ps(v, _mm256_set1_ps(linear_levels), _CMP_LE_OQ));
+    return _mm256_mul_ps(linear, _mm256_set1_ps(coefficient));
+  }
+
+  [[gnu::target("avx2")]]
+  std::size_t planes_to_gray_avx2(const_plane_pointers planes, uint8_t * out, std::size_t count,
+      const gray_power_tables & powers) noexcept {
+    constexpr std::size_t block = 8;
+    const __m256 magnitude = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+    const __m256 threshold = _mm256_set1_ps(static_cast<float>(gamma_threshold));
+    std::size_t p = 0;
+    for (; p + block <= count; p += block) {
+      const __m256 gray = _mm256_add_ps(_mm256_add_ps(
+          linear_avx2(planes[red_channel] + p, red_coefficient, powers.linear),
+          linear_avx2(planes[green_channel] + p, green_coefficient, powers.linear)),
+          linear_avx2(planes[blue_channel] + p, blue_coefficient, powers.linear));
+      const __m256 powered = _mm256_sub_ps(
+          _mm256_mul_ps(power_avx2(gray, powers.root), _mm256_set1_ps(root_scale)),
+          _mm256_set1_ps(root_offset));
+      const __m256 y = _mm256_blendv_ps(powered, _mm256_mul_ps(gray, _mm256_set1_ps(gray_scale)),
+          _mm256_cmp_ps(gray, threshold, _CMP_LE_OQ));
+      const __m256i level = _mm256_cvttps_epi32(_mm256_min_ps(y, _mm256_set1_ps(max_level)));
+      const __m256 fraction = _mm256_sub_ps(y, _mm256_cvtepi32_ps(level));
+      const __m256 near_level = _mm256_or_ps(
+          _mm256_cmp_ps(fraction, _mm256_set1_ps(y_margin), _CMP_LT_OQ),
+          _mm256_cmp_ps(fraction, _mm256_set1_ps(1 - y_margin), _CMP_GT_OQ));
+      const __m256 near_threshold = _mm256_cmp_ps(
+          _mm256_and_ps(_mm256_sub_ps(gray, threshold), magnitude),
+          _mm256_set1_ps(gray_margin), _CMP_LT_OQ);
+      // Black is exact in every lane
+      const __m256 ambiguous = _mm256_andnot_ps(
+          _mm256_cmp_ps(gray, _mm256_setzero_ps(), _CMP_EQ_OQ),
+          _mm256_or_ps(near_level, near_threshold));
+      const __m128i words = _mm_packus_epi32(_mm256_castsi256_si128(level),
+          _mm256_extracti128_si256(level, 1));
+      const __m128i bytes = _mm_packus_epi16(words, words);
+      const auto fix = static_cast<unsigned>(_mm256_movemask_ps(ambiguous));
+      if (fix == 0) {
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(out + p), bytes);
+      }
+      else {
+        std::array<uint8_t, 2 * block> levels{};
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(levels.data()), bytes);
+        store_block(planes, out, p, levels.data(), block, fix);
+      }
+    }
+    return p;
+  }
+
+  [[gnu::target("avx512f")]]
+  inline __m512 power_avx512(__m512 x, const power_table & power) noexcept {
+    const __m512i bits = _mm512_castps_si512(x);
+    const __m512 t = _mm512_sub_ps(_mm512_castsi512_ps(_mm512_or_si512(
+        _mm512_and_si512(bits, _mm512_set1_epi32(mantissa_mask)), _mm512_set1_epi32(one_bits))),
+        _mm512_set1_ps(1.5F));
+    const auto & c = power.polynomial;
+    __m512 result = _mm512_set1_ps(c[6]);
+    result = _mm512_add_ps(_mm512_mul_ps(result, t), _mm512_set1_ps(c[5]));
+    result = _mm512_add_ps(_mm512_mul_ps(result, t), _mm512_set1_ps(c[4]));
+    result = _mm512_add_ps(_mm512_mul_ps(result, t), _mm512_set1_ps(c[3]));
+    result = _mm512_add_ps(_mm512_mul_ps(result, t), _mm512_set1_ps(c[2]));
+    result = _mm512_add_ps(_mm512_mul_ps(result, t), _mm512_set1_ps(c[1]));
+    result = _mm512_add_ps(_mm512_mul_ps(result, t), _mm512_set1_ps(c[0]));
+    const __m512i index = _mm512_sub_epi32(_mm512_srli_epi32(bits, mantissa_bits),
+        _mm512_set1_epi32(exponent_bias + power.lowest_exponent));
+    return _mm512_mul_ps(result, _mm512_permutexvar_ps(index, _mm512_load_ps(power.scales.data())));
+  }
+
+  [[gnu::target("avx512f")]]
+  inline __m512 linear_avx512(const uint8_t * p, float coefficient, const power_table & power)
+  noexcept {
+    const __m512 v = _mm512_cvtepi32_ps(
+        _mm512_cvtepu8_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p))));
+    const __m512 x = _mm512_add_ps(_mm512_mul_ps(v, _mm512_set1_ps(power_factor)),
+        _mm512_set1_ps(power_offset));
+    const __m512 large = _mm512_mul_ps(_mm512_mul_ps(x, x), power_avx512(x, power));
+    const __m512 linear = _mm512_mask_mul_ps(large,
+        _mm512_cmp_ps_mask(v, _mm512_set1_ps(linear_levels), _CMP_LE_OQ), v,
+        _mm512_set1_ps(linear_factor));
+    return _mm512_mul_ps(linear, _mm512_set1_ps(coefficient));
+  }
+
+  [[gnu::target("avx512f")]]
+  std::size_t planes_to_gray_avx512(const_plane_pointers planes, uint8_t * out, std::size_t count,
+      const gray_power_tables & powers) noexcept {
+    constexpr std::size_t block = 16;
+    const __m512 threshold = _mm512_set1_ps(static_cast<float>(gamma_threshold));
+    std::size_t p = 0;
+    for (; p + block <= count; p += block) {
+      const __m512 gray = _mm512_add_ps(_mm512_add_ps(
+          linear_avx512(planes[red_channel] + p, red_coefficient, powers.linear),
+          linear_avx512(planes[green_channel] + p, green_coefficient, powers.linear)),
+          linear_avx512(planes[blue_channel] + p, blue_coefficient, powers.linear));
+      const __m512 powered = _mm512_sub_ps(
+          _mm512_mul_ps(power_avx512(gray, powers.root), _mm512_set1_ps(root_scale)),
+          _mm512_set1_ps(root_offset));
+      const __m512 y = _mm512_mask_mul_ps(powered, _mm512_cmp_ps_mask(gray, threshold, _CMP_LE_OQ),
+          gray, _mm512_set1_ps(gray_scale));
+      const __m512i level = _mm512_cvttps_epi32(_mm512_min_ps(y, _mm512_set1_ps(max_level)));
+      const __m512 fraction = _mm512_sub_ps(y, _mm512_cvtepi32_ps(level));
+      const __mmask16 near_level =
+          _mm512_cmp_ps_mask(fraction, _mm512_set1_ps(y_margin), _CMP_LT_OQ) |
+          _mm512_cmp_ps_mask(fraction, _mm512_set1_ps(1 - y_margin), _CMP_GT_OQ);
+      const __mmask16 near_threshold = _mm512_cmp_ps_mask(
+          _mm512_abs_ps(_mm512_sub_ps(gray, threshold)), _mm512_set1_ps(gray_margin), _CMP_LT_OQ);
+      const __mmask16 ambiguous = _mm512_mask_cmp_ps_mask(near_level | near_threshold, gray,
+          _mm512_setzero_ps(), _CMP_NEQ_OQ);
+      const __m128i bytes = _mm512_cvtepi32_epi8(level);
+      if (ambiguous == 0) {
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + p), bytes);
+      }
+      else {
+        std::array<uint8_t, block> levels{};
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(levels.data()), bytes);
+        store_block(planes, out, p, levels.data(), block, static_cast<unsigned>(ambiguous));
+      }
+    }
+    return p;
+  }
+  // NOLINTEND(cppcoreguidelines-pro-type-reinterpret-cast,cppcoreguidelines-pro-bounds-pointer-arithmetic)
+
+#endif
+
+}
+
+namespace images::common {
+
+  void planes_to_gray(const_plane_pointers planes, uint8_t * out, std::size_t count,
+      [[maybe_unused]] simd_level level) noexcept {
+    std::size_t done = 0;
+#if defined(__x86_64__) || defined(__i386__)
+    // SSE4 has neither the lanes nor the permutes to beat the scalar lookup
+    if (level == simd_level::avx512) {
+      done = planes_to_gray_avx512(planes, out, count, gray_powers());
+    }
+    else if (level == simd_level::avx2) {
+      done = planes_to_gray_avx2(planes, out, count, gray_powers());
+    }
+#endif
+    planes_to_gray_scalar(planes, out, done, count);
+  }
+
+  const gray_level_map & gray_of_gray() noexcept {
+    static const auto map = [] {
+      gray_level_map table{};
+      for (std::size_t v = 0; v < table.size(); ++v) {
+        const auto level = static_cast<uint8_t>(v);
+        table[v] = to_gray_corrected(level, level, level);
+      }
+      return table;
+    }();
+    return map;
+  }
+
+  void gray_plane_to_gray(std::span<uint8_t> levels) noexcept {
+    const auto & map = gray_of_gray();
+    for (auto & level: levels) { level = map[level]; }
+  }
+
+  simd_level gray_kernel_level() noexcept {
+    return detected_simd_level() == simd_level::avx512 ? simd_level::avx512 : simd_level::scalar;
+  }
+
+  // Each red level is a plane of all green and blue levels, converted in one call
+  std::vector<gray_mismatch> verify_gray_kernel(simd_level level) {
+    constexpr int levels = gray_table::levels;
+    constexpr std::size_t plane_size = std::size_t{levels} * levels;
+    std::vector<std::vector<gray_mismatch>> found(levels);
+#pragma omp parallel default(none) shared(level, found)
+    {
+      std::array<std::vector<uint8_t>, num_channels> planes;
+      for (auto & plane: planes) { plane.resize(plane_size); }
+      std::vector<uint8_t> out(plane_size);
+#pragma omp for
+      for (int r = 0; r < levels; ++r) {
+        for (std::size_t i = 0; i < plane_size; ++i) {
+          planes[red_channel][i] = static_cast<uint8_t>(r);
+          planes[green_channel][i] = static_cast<uint8_t>(i / levels);
+          planes[blue_channel][i] = static_cast<uint8_t>(i % levels);
+        }
+        planes_to_gray({planes[0].data(), planes[1].data(), planes[2].data()}, out.data(),
+            plane_size, level);
+        for (std::size_t i = 0; i < plane_size; ++i) {
+          const auto red = static_cast<uint8_t>(r);
+          const auto green = static_cast<uint8_t>(i / levels);
+          const auto blue = static_cast<uint8_t>(i % levels);
+          const auto expected = to_gray_corrected(red, green, blue);
+          if (out[i] != expected) {
+            found[r].push_back({red, green, blue, expected, out[i]});
+          }
+        }
+      }
+    }
+    std::vector<gray_mismatch> mismatches;
+    for (const auto & part: found) {
+      mismatches.insert(mismatches.end(), part.begin(), part.end());
+    }
+    return mismatches;
+  }
+
+  std::ostream & operator<<(std::ostream & os, const gray_mismatch & mismatch) {
+    return os << "(" << int{mismatch.red} << "," << int{mismatch.green} << ","
+              << int{mismatch.blue} << "): expected " << int{mismatch.expected} << ", got "
+              << int{mismatch.actual};
+  }
+
+  bool verify_gray_kernels(std::ostream & os) {
+    bool all_match = true;
+    for (const auto level: supported_simd_levels()) {
+      const auto mismatches = verify_gray_kernel(level);
+      os << "Gray kernel at " << to_string(level) << ": " << mismatches.size()
+         << " mismatches\n";
+      for (const auto & mismatch: mismatches) { os << "  " << mismatch << '\n'; }
+      all_match = all_match and mismatches.empty();
+    }
+    return all_match;
+  }
+
+}
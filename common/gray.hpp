@@ -0,0 +1,61 @@
+#ifndef IMAGES_COMMON_GRAY_HPP
+#define IMAGES_COMMON_GRAY_HPP
+
+#include "common/normalized_pixel.hpp"
+#include "common/planar.hpp"
+#include "common/simd.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <span>
+#include <vector>
+
+namespace images::common {
+
+  // Writes to_gray_corrected of count pixels, one plane per channel, to out, which may be one of
+  // the planes. The vector kernels evaluate both powers of the formula with polynomials in float
+  // lanes; lanes whose result lies too close to a level boundary, or to the gamma threshold, for
+  // the approximation error to be ruled out are recomputed by the scalar lookup of gray_table.
+  void planes_to_gray(const_plane_pointers planes, uint8_t * out, std::size_t count,
+      simd_level level = detected_simd_level()) noexcept;
+
+  using gray_level_map = std::array<uint8_t, gray_table::levels>;
+
+  // to_gray_corrected of each gray level. Gray pixels do not all keep their level, as the formula
+  // truncates.
+  const gray_level_map & gray_of_gray() noexcept;
+
+  // Applies to_gray_corrected to a gray image kept as one level per pixel
+  void gray_plane_to_gray(std::span<uint8_t> levels) noexcept;
+
+  // Level at which planes_to_gray is fastest on the running CPU. Eight float lanes do not beat the
+  // table lookup, so only AVX-512 is used.
+  simd_level gray_kernel_level() noexcept;
+
+  // Input on which planes_to_gray and to_gray_corrected disagree
+  struct gray_mismatch {
+    uint8_t red;
+    uint8_t green;
+    uint8_t blue;
+    uint8_t expected;
+    uint8_t actual;
+
+    bool operator==(const gray_mismatch &) const noexcept = default;
+  };
+
+  // Runs planes_to_gray at level over all 2^24 colours and returns every one where it differs
+  // from to_gray_corrected, ordered by red, green and blue
+  std::vector<gray_mismatch> verify_gray_kernel(simd_level level);
+
+  // Writes a mismatch as (red,green,blue): expected level, got level
+  std::ostream & operator<<(std::ostream & os, const gray_mismatch & mismatch);
+
+  // Runs verify_gray_kernel at every supported level, writing the number of mismatches of each
+  // and then every mismatch to os. Returns whether no level has any.
+  bool verify_gray_kernels(std::ostream & os);
+
+}
+
+#endif //IMAGES_COMMON_GRAY_HPP
@@ -1,6 +1,6 @@
 #include "histogram.hpp"
 #include <fstream>
-#include<omp.h>
+#include <utility>
 namespace images::common {
 
   void histogram::add_color(pixel p) noexcept {
@@ -20,18 +20,90 @@ namespace images::common {
       os << x << '\n';
     }
   }
-    void histogram::merge_histos(std::vector<histogram>h, int nthreads){
-        for(int i=0; i<256; i++){ //maximum of lines(channels) that a histo can have.
-            int sred=0, sgreen=0, sblue=0; //reset the sum
-            for(int j=0; j<nthreads; j++){
-                sred += h[j].get_red_frequency(i); //accumulate the partial values of the frequency to obtain the total
-                sblue += h[j].get_blue_frequency(i);
-                sgreen += h[j].get_green_frequency(i);
-            }
-            channels[red_channel][i]= sred;
-            channels[green_channel][i]= sgreen;
-            channels[blue_channel][i] = sblue;
+
+  histogram_counters::histogram_counters(int threads) : blocks(static_cast<std::size_t>(threads)) {
+  }
+
+  // Every pixel of a group is read before the first counter is stored to, as the stores may alias
+  // the bytes the pixels are read from. Table and bank offsets are constants, so a single pointer
+  // addresses all the counters.
+  template <auto Tables, typename Values>
+  void histogram_counters::add_pixels(int thread, std::size_t count, Values values) noexcept {
+    using levels = std::array<uint8_t, Tables.size()>;
+    std::uint32_t * counts = blocks[thread].counts.data();
+    const auto add = [counts]<std::size_t... T>(std::size_t bank, const levels & pixel,
+        std::index_sequence<T...>) {
+      (++counts[bank * bank_size + Tables[T] * num_levels + pixel[T]], ...);
+    };
+    constexpr auto tables = std::make_index_sequence<Tables.size()>{};
+    const auto add_group = [&]<std::size_t... B>(std::size_t i, std::index_sequence<B...>) {
+      const std::array<levels, num_banks> group{values(i + B)...};
+      (add(B, group[B], tables), ...);
+    };
+    std::size_t i = 0;
+    for (; i + num_banks <= count; i += num_banks) {
+      add_group(i, std::make_index_sequence<num_banks>{});
+    }
+    for (; i < count; ++i) {
+      add(0, values(i), tables);
+    }
+  }
+
+  namespace {
+    constexpr std::array<std::size_t, num_channels> bgr_tables{
+        blue_channel, green_channel, red_channel};
+  }
+
+  void histogram_counters::count_bgr(int thread, std::span<const uint8_t> bgr) noexcept {
+    const uint8_t * data = bgr.data();
+    add_pixels<bgr_tables>(thread, bgr.size() / num_channels, [data](std::size_t i) {
+      const uint8_t * p = data + i * num_channels;
+      return std::array<uint8_t, num_channels>{p[0], p[1], p[2]};
+    });
+  }
+
+  void histogram_counters::count_planes(int thread, const_plane_pointers planes,
+      std::size_t count) noexcept {
+    add_pixels<bgr_tables>(thread, count, [planes](std::size_t i) {
+      return std::array<uint8_t, num_channels>{planes[0][i], planes[1][i], planes[2][i]};
+    });
+  }
+
+  void histogram_counters::count_gray(int thread, std::span<const uint8_t> levels,
+      int step) noexcept {
+    const uint8_t * data = levels.data();
+    const auto stride = static_cast<std::size_t>(step);
+    add_pixels<std::array{gray_table}>(thread, (levels.size() + stride - 1) / stride,
+        [data, stride](std::size_t i) { return std::array<uint8_t, 1>{data[i * stride]}; });
+  }
+
+  void histogram_counters::count_gray(int thread, std::span<const uint8_t> levels,
+      const level_map & map) noexcept {
+    const uint8_t * data = levels.data();
+    add_pixels<std::array{gray_table}>(thread, levels.size(),
+        [data, &map](std::size_t i) { return std::array<uint8_t, 1>{map[data[i]]}; });
+  }
+
+  histogram histogram_counters::merge() const noexcept {
+    histogram histo;
+    constexpr int num_counts = num_channels * histogram::num_levels;
+    const int threads = static_cast<int>(blocks.size());
+    // Each thread sums its own range of levels straight into histo
+#pragma omp parallel for schedule(static) if(threads > 1) default(none) shared(histo, threads)
+    for (int i = 0; i < num_counts; ++i) {
+      const auto channel = static_cast<std::size_t>(i / histogram::num_levels);
+      const auto level = static_cast<std::size_t>(i % histogram::num_levels);
+      std::int64_t total = 0;
+      for (const auto & blk : blocks) {
+        for (std::size_t bank = 0; bank < num_banks; ++bank) {
+          const std::uint32_t * counts = blk.counts.data() + bank * bank_size;
+          total += counts[channel * num_levels + level];
+          total += counts[gray_table * num_levels + level];
         }
+      }
+      histo.channels[channel][level] = total;
     }
+    return histo;
+  }
 
 }
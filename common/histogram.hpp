@@ -2,15 +2,22 @@
 #define IMAGES_COMMON_HISTOGRAM_HPP
 
 #include "common/pixel.hpp"
+#include "common/planar.hpp"
 
-#include <vector>
+#include <array>
+#include <cstddef>
 #include <cstdint>
 #include <filesystem>
+#include <span>
+#include <vector>
+#include <omp.h>
 
 namespace images::common {
 
   class histogram {
   public:
+    static constexpr int num_levels = 256;
+
     histogram() noexcept = default;
 
     void add_color(pixel p) noexcept;
@@ -21,30 +28,77 @@ namespace images::common {
 
     void add_blue(uint8_t b) noexcept { channels[blue_channel][b]++; }
 
-    [[nodiscard]] int get_red_frequency(uint8_t v) const noexcept {
+    [[nodiscard]] std::int64_t get_red_frequency(uint8_t v) const noexcept {
       return channels[red_channel][v];
     }
 
-    [[nodiscard]] int get_green_frequency(uint8_t v) const noexcept {
+    [[nodiscard]] std::int64_t get_green_frequency(uint8_t v) const noexcept {
       return channels[green_channel][v];
     }
 
-    [[nodiscard]] int get_blue_frequency(uint8_t v) const noexcept {
+    [[nodiscard]] std::int64_t get_blue_frequency(uint8_t v) const noexcept {
       return channels[blue_channel][v];
     }
 
     void write(std::ostream & os) const noexcept;
 
-    void merge_histos(std::vector<histogram>h, int nthreads);
+  private:
+    friend class histogram_counters;
+
+    std::array<std::array<std::int64_t, num_levels>, num_channels> channels{};
+  };
 
+  using level_map = std::array<uint8_t, histogram::num_levels>;
+
+  // Counters filled by the threads of a parallel loop and merged into a histogram. Each thread
+  // counts into its own cache-line aligned block, which holds several banks of counters:
+  // consecutive pixels go to different banks, so that a run of one value does not wait for the
+  // store of its previous increment. Gray levels have a table of their own, counted once for
+  // the three channels.
+  class histogram_counters {
+  public:
+    explicit histogram_counters(int threads = omp_get_max_threads());
+
+    // Counts packed BGR pixels for the given thread
+    void count_bgr(int thread, std::span<const uint8_t> bgr) noexcept;
+
+    // Counts count pixels held in one plane per channel
+    void count_planes(int thread, const_plane_pointers planes, std::size_t count) noexcept;
+
+    // Counts one gray level every step bytes of levels
+    void count_gray(int thread, std::span<const uint8_t> levels, int step = 1) noexcept;
+
+    // Counts map[level] for each of levels
+    void count_gray(int thread, std::span<const uint8_t> levels, const level_map & map) noexcept;
+
+    // Sums the counters of every thread and bank, in parallel over the levels
+    [[nodiscard]] histogram merge() const noexcept;
 
   private:
-    static constexpr int num_levels = 256;
-    std::array<std::vector<int>, 3> channels = {std::vector<int>(num_levels),
-                                                std::vector<int>(num_levels),
-                                                std::vector<int>(num_levels),};
+    static constexpr std::size_t num_banks = 4;
+    static constexpr std::size_t gray_table = num_channels;
+    static constexpr std::size_t num_tables = num_channels + 1;
+    static constexpr std::size_t cache_line = 64;
+    static constexpr std::size_t num_levels = histogram::num_levels;
+
+    // Banks are a whole number of 4 KiB pages apart but for one cache line, so that counters of
+    // one level in different banks do not share the page offset that store forwarding compares
+    static constexpr std::size_t bank_size =
+        num_tables * num_levels + cache_line / sizeof(std::uint32_t);
+
+    // An image has fewer than 2^31 pixels, so no 32-bit counter overflows before the merge
+    struct alignas(cache_line) block {
+      std::array<std::uint32_t, num_banks * bank_size> counts{};
+    };
+
+    // Adds count pixels to the block of thread, pixel i to bank i % num_banks, where values(i)
+    // gives its level in each of Tables
+    template <auto Tables, typename Values>
+    void add_pixels(int thread, std::size_t count, Values values) noexcept;
+
+    std::vector<block> blocks;
   };
 
 } // common
 
-#endif //IMAGES_COMMON_HISTOGRAM_HPP
\ No newline at end of file
+#endif //IMAGES_COMMON_HISTOGRAM_HPP
@@ -3,14 +3,64 @@
 
 #include "progargs.hpp"
 #include "file_error.hpp"
+#include "bitmap_view.hpp"
+#include "file_copy.hpp"
+#include "bounded_queue.hpp"
+#include "streaming.hpp"
+#include "gauss.hpp"
+#include "convolution.hpp"
+#include "schedule.hpp"
+#include <algorithm>
 #include <chrono>
 #include <iostream>
 #include <fstream>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
 
 namespace images::common {
 
+  // Files above this size are converted to gray in bands instead of being loaded whole
+  constexpr std::uintmax_t stream_min_size = std::uintmax_t{1} << 28;
+
+  // Files waiting between two pipeline stages; bounds how many images are in memory at once
+  constexpr std::size_t pipeline_depth = 1;
+
+  // Images up to this many pixels are processed one per thread instead of by a whole team
+  constexpr long parallel_file_max_pixels = 1L << 18;
+
+  inline images::common::gauss_mode to_gauss_mode(const images::common::options & opts) noexcept {
+    return opts.approximate_gauss ? images::common::gauss_mode::approximate :
+                                    images::common::gauss_mode::exact;
+  }
+
+  // Schedule of the loops behind subcmd: whole tiles for gauss, plain rows for the others
+  inline images::common::loop_schedule default_loop_schedule(images::common::subcommand subcmd)
+  noexcept {
+    if (subcmd == images::common::subcommand::gauss) { return {omp_sched_dynamic, 1}; }
+    return {};
+  }
+
+  inline images::common::loop_schedule schedule_for(images::common::subcommand subcmd,
+      const images::common::options & opts) noexcept {
+    return opts.schedule.value_or(default_loop_schedule(subcmd));
+  }
+
+  // Operations, joined by commas, as a key of the schedule profile
+  inline std::string chain_name(const std::vector<images::common::subcommand> & steps,
+      images::common::subcommand last) {
+    std::string name;
+    for (const auto step: steps) { name += std::string{to_string(step)} + ","; }
+    return name + std::string{to_string(last)};
+  }
+
   template<typename image_type>
-  void process_image(image_type & image, images::common::subcommand subcmd) noexcept {
+  void process_image(image_type & image, images::common::subcommand subcmd,
+      const images::common::options & opts = {}) noexcept {
+    const images::common::scoped_schedule schedule{schedule_for(subcmd, opts)};
     switch (subcmd) {
       case images::common::subcommand::copy:
         break;
@@ -18,84 +68,431 @@ namespace images::common {
         image.to_gray();
         break;
       case images::common::subcommand::gauss:
-        image.gauss();
+        image.gauss(to_gauss_mode(opts));
+        break;
+      case images::common::subcommand::box:
+        image.filter(images::common::convolution_filter::box);
+        break;
+      case images::common::subcommand::sharpen:
+        image.filter(images::common::convolution_filter::sharpen);
+        break;
+      case images::common::subcommand::emboss:
+        image.filter(images::common::convolution_filter::emboss);
+        break;
+      case images::common::subcommand::blur:
+        image.blur(opts.blur_sigma);
         break;
       case images::common::subcommand::info:
         [[fallthrough]];
+      case images::common::subcommand::verify_gray:
+        [[fallthrough]];
       default:
         break;
     }
   }
 
+  // Runs steps and then last over image, all in memory. Consecutive gauss steps are blurred in
+  // one pass, a gauss followed by mono converts each row as soon as it is blurred, and a mono
+  // followed by the final histo only counts the gray levels. Returns the histogram when last is
+  // histo.
   template<typename image_type>
-  auto generate_output(const std::filesystem::path & out_dir, const std::filesystem::path & in_file,
-      images::common::subcommand subcmd) {
-    using clk = std::chrono::high_resolution_clock;
-    image_type image;
-    image.read(in_file);
-    auto read_time = clk::now();
-
-    if (subcmd == images::common::subcommand::info) {
-      auto process_time = clk::now();
-      image.print_info(std::cout);
-      auto write_time = clk::now();
-      return std::tuple{read_time, process_time, write_time};
-    }
-    if (subcmd != images::common::subcommand::histo) {
-      process_image(image, subcmd);
-      auto process_time = clk::now();
-      image.write(out_dir / in_file.filename());
-      auto write_time = clk::now();
-      return std::tuple{read_time, process_time, write_time};
-    }
-    auto histo = image.generate_histogram();
-    auto process_time = clk::now();
-    std::ofstream histogram_out{out_dir / in_file.filename().replace_extension(".hst")};
-    histo.write(histogram_out);
-    auto write_time = clk::now();
-    return std::tuple{read_time, process_time, write_time};
+  std::optional<images::common::histogram> process_chain(image_type & image,
+      const std::vector<images::common::subcommand> & steps, images::common::subcommand last,
+      const images::common::options & opts) noexcept {
+    using enum images::common::subcommand;
+    std::vector<images::common::subcommand> chain{steps};
+    chain.push_back(last);
+    for (std::size_t i = 0; i < chain.size(); ++i) {
+      if (chain[i] == gauss) {
+        std::size_t end = i;
+        while (end < chain.size() and chain[end] == gauss) { ++end; }
+        const auto iterations = static_cast<int>(end - i);
+        const images::common::scoped_schedule schedule{schedule_for(gauss, opts)};
+        if (end < chain.size() and chain[end] == mono) {
+          image.gauss_to_gray(to_gauss_mode(opts), iterations);
+          i = end;
+        }
+        else {
+          image.gauss(to_gauss_mode(opts), iterations);
+          i = end - 1;
+        }
+        continue;
+      }
+      const bool next_histo = i + 1 < chain.size() and chain[i + 1] == histo;
+      if (chain[i] == mono and next_histo) {
+        const images::common::scoped_schedule schedule{schedule_for(histo, opts)};
+        return image.gray_histogram();
+      }
+      else if (chain[i] == histo) {
+        const images::common::scoped_schedule schedule{schedule_for(histo, opts)};
+        return image.generate_histogram();
+      }
+      else {
+        process_image(image, chain[i], opts);
+      }
+    }
+    return std::nullopt;
   }
 
-  void print_times(auto times) noexcept {
+  void print_times(std::ostream & os, auto times) noexcept {
     using namespace std::chrono;
-    std::cout << " time(" << duration_cast<microseconds>(times[0]).count() << ")\n";
-    std::cout << "  Load time: " << duration_cast<microseconds>(times[1]).count() << "\n";
-    std::cout << "  Process time: " << duration_cast<microseconds>(times[2]).count() << '\n';
-    std::cout << "  Store time: " << duration_cast<microseconds>(times[3]).count() << '\n';
+    os << " time(" << duration_cast<microseconds>(times[0]).count() << ")\n";
+    os << "  Load time: " << duration_cast<microseconds>(times[1]).count() << "\n";
+    os << "  Process time: " << duration_cast<microseconds>(times[2]).count() << '\n';
+    os << "  Store time: " << duration_cast<microseconds>(times[3]).count() << '\n';
   }
 
+  // One input file on its way through the load, process and store stages. Each stage records its
+  // own time and error, so stages of different files may run on different threads.
   template<typename image_type>
-  void process_file(const std::filesystem::path & in_file, const std::filesystem::path & out_dir,
-      images::common::subcommand subcmd) noexcept {
+  class image_job {
+  public:
+    image_job(std::filesystem::path in_file, std::filesystem::path out_dir,
+        images::common::subcommand subcmd, images::common::options opts,
+        std::vector<images::common::subcommand> steps = {}) :
+        in_file_{std::move(in_file)}, out_dir_{std::move(out_dir)}, subcmd_{subcmd}, opts_{opts},
+        steps_{std::move(steps)} { }
+
+    void load() noexcept { run_stage(load_time, [this] { do_load(); }); }
+
+    // With a profile, the schedule is first looked up or tuned for this image
+    void process(images::common::schedule_profile * profile = nullptr) noexcept {
+      run_stage(process_time, [this, profile] {
+        if (profile != nullptr) { tune(*profile); }
+        do_process();
+      });
+    }
+
+    void store() noexcept {
+      run_stage(store_time, [this] { do_store(); });
+      // Only the report is needed from now on
+      image = image_type{};
+      view = images::common::bitmap_view{};
+      histo.reset();
+    }
+
+    void report() const noexcept {
+      std::cout << "File: " << in_file_.string() << '\n';
+      if (error) {
+        std::cerr << "File: " << in_file_ << std::endl;
+        std::cerr << "  Cannot process file: " << in_file_.string() << '\n';
+        std::cerr << "  Reason: " << to_string(error->kind) << '\n';
+        return;
+      }
+      if (unexpected_error) {
+        std::cerr << "File: " << in_file_ << std::endl;
+        std::cerr << "  Unexpected error in file " << in_file_.string() << '\n';
+        return;
+      }
+      std::cout << info_text.str();
+      const std::array times = {load_time + process_time + store_time, load_time, process_time,
+                                process_time + store_time};
+      std::cout << "File: " << in_file_.string();
+      print_times(std::cout, times);
+    }
+
+  private:
+    using clk = std::chrono::high_resolution_clock;
+
+    enum class job_mode {
+      loaded,   // pixels read into image_type
+      header,   // info, nothing but the header is read
+      mapped,   // histo over the mapped file
+      copied,   // copy done by the kernel, pixels are never loaded
+      streamed  // mono over row bands for files too large to load
+    };
+
+    void run_stage(clk::duration & elapsed, auto stage) noexcept {
+      if (error or unexpected_error) { return; }
+      const auto start = clk::now();
+      try {
+        stage();
+      } catch (images::common::file_error e) {
+        error = e;
+      } catch (...) {
+        unexpected_error = true;
+      }
+      elapsed = clk::now() - start;
+    }
+
+    void do_load() {
+      using enum images::common::subcommand;
+      if (!steps_.empty()) {
+        // A chain runs in memory from one load to one store
+        image.read(in_file_);
+        return;
+      }
+      if (subcmd_ == info) {
+        mode = job_mode::header;
+        std::ifstream in{in_file_};
+        if (!in) {
+          throw images::common::file_error{images::common::file_error_kind::cannot_open};
+        }
+        header.read(in);
+        return;
+      }
+      if (subcmd_ == histo) {
+        mode = job_mode::mapped;
+        view.read(in_file_);
+        return;
+      }
+      if (subcmd_ == copy) {
+        // Only the header is checked here, the pixels go straight from file to file when storing
+        mode = job_mode::copied;
+        std::ifstream in{in_file_};
+        if (!in) {
+          throw images::common::file_error{images::common::file_error_kind::cannot_open};
+        }
+        header.read(in);
+        return;
+      }
+      std::error_code size_error;
+      const auto file_size = std::filesystem::file_size(in_file_, size_error);
+      std::error_code same_error;
+      if (subcmd_ == mono and !size_error and file_size > stream_min_size and
+          !std::filesystem::equivalent(in_file_, out_dir_ / in_file_.filename(), same_error)) {
+        // Loading and storing overlap band by band, so all of it is reported as processing.
+        // A file written over itself is loaded whole instead.
+        mode = job_mode::streamed;
+        return;
+      }
+      image.read(in_file_);
+    }
+
+    // Only histograms, gray conversions, gauss blurs and convolution filters have loops to
+    // schedule
+    [[nodiscard]] bool has_schedule() const noexcept {
+      using enum images::common::subcommand;
+      if (mode != job_mode::loaded and mode != job_mode::mapped) { return false; }
+      const auto scheduled = [](images::common::subcommand op) {
+        return op == histo or op == mono or op == gauss or op == box or op == sharpen or
+               op == emboss;
+      };
+      return scheduled(subcmd_) or std::ranges::any_of(steps_, scheduled);
+    }
+
+    // The first image of a chain and size class runs once per candidate, each time over a copy,
+    // and the fastest schedule is kept for every later image of that class. Schedules found with
+    // another number of threads are not reused.
+    void tune(images::common::schedule_profile & profile) {
+      if (!has_schedule()) { return; }
+      const auto name = chain_name(steps_, subcmd_);
+      const long pixels = mode == job_mode::mapped ? view.width() * long{view.height()} :
+                                                     image.width() * long{image.height()};
+      const int size = images::common::size_class(pixels);
+      const int threads = omp_get_max_threads();
+      if (const auto known = profile.find(name, size, threads)) {
+        opts_.schedule = known;
+        return;
+      }
+      images::common::loop_schedule best;
+      std::optional<clk::duration> best_time;
+      for (const auto candidate: images::common::schedule_candidates) {
+        opts_.schedule = candidate;
+        image_type trial;
+        if (mode == job_mode::loaded) { trial = image; }
+        const auto start = clk::now();
+        if (mode == job_mode::mapped) {
+          const images::common::scoped_schedule schedule{candidate};
+          static_cast<void>(view.generate_histogram());
+        }
+        else {
+          static_cast<void>(run_loaded(trial));
+        }
+        const auto elapsed = clk::now() - start;
+        if (!best_time or elapsed < *best_time) {
+          best = candidate;
+          best_time = elapsed;
+        }
+      }
+      profile.store(name, size, threads, best);
+      opts_.schedule = best;
+    }
+
+    std::optional<images::common::histogram> run_loaded(image_type & target) const noexcept {
+      if (steps_.empty()) {
+        process_image(target, subcmd_, opts_);
+        return std::nullopt;
+      }
+      return process_chain(target, steps_, subcmd_, opts_);
+    }
+
+    void do_process() {
+      switch (mode) {
+        case job_mode::mapped: {
+          const images::common::scoped_schedule schedule{schedule_for(subcmd_, opts_)};
+          histo = view.generate_histogram();
+          break;
+        }
+        case job_mode::header:
+          break;
+        case job_mode::streamed:
+          images::common::stream_gray(in_file_, out_dir_ / in_file_.filename());
+          break;
+        case job_mode::copied:
+          break;
+        case job_mode::loaded:
+          histo = run_loaded(image);
+          break;
+      }
+    }
+
+    void do_store() {
+      switch (mode) {
+        case job_mode::header:
+          header.print_info(info_text);
+          break;
+        case job_mode::mapped: {
+          std::ofstream histogram_out{out_dir_ / in_file_.filename().replace_extension(".hst")};
+          histo->write(histogram_out);
+          break;
+        }
+        case job_mode::copied:
+          images::common::copy_bitmap(header, in_file_, out_dir_ / in_file_.filename());
+          break;
+        case job_mode::streamed:
+          break;
+        case job_mode::loaded:
+          if (histo) {
+            std::ofstream histogram_out{out_dir_ / in_file_.filename().replace_extension(".hst")};
+            histo->write(histogram_out);
+          }
+          else {
+            image.write(out_dir_ / in_file_.filename(), opts_.gray_palette);
+          }
+          break;
+      }
+    }
+
+    std::filesystem::path in_file_;
+    std::filesystem::path out_dir_;
+    images::common::subcommand subcmd_;
+    images::common::options opts_;
+    std::vector<images::common::subcommand> steps_;
+    job_mode mode = job_mode::loaded;
+    image_type image;
+    images::common::bitmap_view view;
+    images::common::bitmap_header header;
+    std::optional<images::common::histogram> histo;
+    std::ostringstream info_text;
+    clk::duration load_time{};
+    clk::duration process_time{};
+    clk::duration store_time{};
+    std::optional<images::common::file_error> error;
+    bool unexpected_error = false;
+  };
+
+  // Number of pixels of a bitmap as told by its header, if the header can be read
+  inline std::optional<long> header_pixels(const std::filesystem::path & in_file) noexcept {
     try {
-      std::cout << "File: " << in_file.string() << '\n';
-      using clk = std::chrono::high_resolution_clock;
-      const auto start_time = clk::now();
-      const auto [read_time, process_time, write_time] = generate_output<image_type>(out_dir,
-          in_file, subcmd);
-      const std::array times = {write_time - start_time, read_time - start_time,
-                                process_time - read_time, write_time - read_time};
-      std::cout << "File: " << in_file.string();
-      print_times(times);
-
-    } catch (images::common::file_error e) {
-      std::cerr << "File: " << in_file << std::endl;
-      std::cerr << "  Cannot process file: " << in_file.string() << '\n';
-      std::cerr << "  Reason: " << to_string(e.kind) << '\n';
+      std::ifstream in{in_file};
+      images::common::bitmap_header header;
+      header.read(in);
+      return header.image_size();
     } catch (...) {
-      std::cerr << "File: " << in_file << std::endl;
-      std::cerr << "  Unexpected error in file " << in_file.string() << '\n';
+      return std::nullopt;
+    }
+  }
+
+  // Processes small images spread across threads, one file per thread. Kernels called from here
+  // run inside an active parallel region, so their own teams have a single thread.
+  template<typename image_type>
+  std::vector<std::unique_ptr<image_job<image_type>>> process_small_files(
+      const std::vector<std::filesystem::path> & files, const std::filesystem::path & out_dir,
+      images::common::subcommand subcmd, const images::common::options & opts,
+      const std::vector<images::common::subcommand> & steps) noexcept {
+    const auto count = std::ssize(files);
+    std::vector<std::unique_ptr<image_job<image_type>>> jobs(files.size());
+#pragma omp parallel for schedule(dynamic) default(none) \
+    shared(count, files, out_dir, subcmd, opts, steps, jobs)
+    for (long i = 0; i < count; ++i) {
+      auto & current = jobs[i];
+      current = std::make_unique<image_job<image_type>>(files[i], out_dir, subcmd, opts, steps);
+      current->load();
+      current->process();
+      current->store();
     }
+    return jobs;
   }
 
+  // Runs the large files through a three stage pipeline: a reader thread loads the next file while
+  // this thread processes the current one with OpenMP and a writer thread stores the previous
+  // one. before_report is called with the position of each file just ahead of its report.
+  template<typename image_type>
+  void process_large_files(const std::vector<std::filesystem::path> & files,
+      const std::vector<std::size_t> & positions, const std::filesystem::path & out_dir,
+      images::common::subcommand subcmd, const images::common::options & opts,
+      const std::vector<images::common::subcommand> & steps,
+      images::common::schedule_profile * profile, auto before_report) noexcept {
+    using job = image_job<image_type>;
+    bounded_queue<std::pair<std::size_t, std::unique_ptr<job>>> loaded{pipeline_depth};
+    bounded_queue<std::pair<std::size_t, std::unique_ptr<job>>> processed{pipeline_depth};
+    const std::jthread reader{[&] {
+      for (const auto position: positions) {
+        auto next = std::make_unique<job>(files[position], out_dir, subcmd, opts, steps);
+        next->load();
+        loaded.push({position, std::move(next)});
+      }
+      loaded.close();
+    }};
+    const std::jthread writer{[&] {
+      while (auto done = processed.pop()) {
+        auto & [position, finished] = *done;
+        finished->store();
+        before_report(position);
+        finished->report();
+      }
+    }};
+    while (auto current = loaded.pop()) {
+      current->second->process(profile);
+      processed.push(std::move(*current));
+    }
+    processed.close();
+  }
+
+  // Small images are processed first, several at a time, and large images then go through the
+  // pipeline. Reports come out in directory order either way.
   template<typename image_type>
   void process(const images::common::configuration & cfg) noexcept {
     namespace fs = std::filesystem;
     std::cout << "Input path: " << cfg.input_dir << '\n';
     std::cout << "Output path: " << cfg.output_dir << '\n';
+
+    std::vector<fs::path> files;
     for (const auto & in_file: fs::directory_iterator(cfg.input_dir)) {
-      process_file<image_type>(in_file, cfg.output_dir, cfg.subcmd);
+      files.push_back(in_file);
+    }
+    std::vector<fs::path> small_files;
+    std::vector<std::size_t> small_positions;
+    std::vector<std::size_t> large_positions;
+    for (std::size_t i = 0; i < files.size(); ++i) {
+      // info never touches pixels, so every file is a small one and the directory is scanned in
+      // parallel
+      if (cfg.subcmd == images::common::subcommand::info or
+          header_pixels(files[i]).value_or(0) <= parallel_file_max_pixels) {
+        small_files.push_back(files[i]);
+        small_positions.push_back(i);
+      }
+      else {
+        large_positions.push_back(i);
+      }
     }
+
+    const auto small_jobs = process_small_files<image_type>(small_files, cfg.output_dir,
+        cfg.subcmd, cfg.opts, cfg.steps);
+    std::size_t next_small = 0;
+    const auto report_small_before = [&](std::size_t position) {
+      for (; next_small < small_jobs.size() and small_positions[next_small] < position;
+             ++next_small) {
+        small_jobs[next_small]->report();
+      }
+    };
+    // Small images run on one thread each, so only the large ones are worth tuning
+    std::optional<images::common::schedule_profile> profile;
+    if (cfg.opts.autotune) { profile.emplace(cfg.schedule_file); }
+    process_large_files<image_type>(files, large_positions, cfg.output_dir, cfg.subcmd,
+        cfg.opts, cfg.steps, profile ? &*profile : nullptr, report_small_before);
+    report_small_before(files.size());
   }
 
 }
@@ -1,23 +1,12 @@
 #include "normalized_pixel.hpp"
+#include <bit>
 #include <cmath>
+#include <cstdint>
+#include <limits>
 #include <omp.h>
 
 namespace images::common {
 
-  namespace {
-  [[maybe_unused]] constexpr double intensity_threshold = 0.04045;
-    constexpr double intensity_divisor1 = 12.92;
-    constexpr double intensity_divisor2 = 1.055;
-    constexpr double intensity_delta = 0.055;
-    constexpr double intensity_exponent = 2.4;
-    constexpr double intensity_exponent_inv = 1.0 / intensity_exponent;
-    constexpr double gamma_threshold = 0.003108;
-
-    constexpr double red_coefficient = 0.2126;
-    constexpr double green_coefficient = 0.7152;
-    constexpr double blue_coefficient = 0.0722;
-  }
-
   void normalized_pixel::intensity_transform() noexcept {
     for (int i = 0; i < static_cast<int>(color.size()); ++i) {
       if (color[i] <= intensity_threshold) {
@@ -44,4 +33,45 @@ namespace images::common {
     return static_cast<uint8_t>(g * intensity_max_value);
   }
 
+  gray_table::gray_table() noexcept {
+    for (int v = 0; v < levels; ++v) {
+      const auto level = static_cast<uint8_t>(v);
+      normalized_pixel linear{level, level, level};
+      linear.intensity_transform();
+      red[v] = red_coefficient * linear.red();
+      green[v] = green_coefficient * linear.green();
+      blue[v] = blue_coefficient * linear.blue();
+    }
+    // Output levels only grow with the linear gray level, which stays within 0 .. 1
+    const auto output = [](double g) { return gray_denormalize(gamma_correction(g)); };
+    const auto one = std::bit_cast<std::uint64_t>(1.0);
+    thresholds[0] = -std::numeric_limits<double>::infinity();
+    for (int k = 1; k <= levels; ++k) {
+      if (k == levels or output(1.0) < k) {
+        thresholds[k] = std::numeric_limits<double>::infinity();
+        continue;
+      }
+      // Bit patterns of non-negative doubles are ordered as the doubles
+      std::uint64_t below = 0;
+      std::uint64_t reaching = one;
+      while (reaching - below > 1) {
+        const std::uint64_t middle = below + (reaching - below) / 2;
+        if (output(std::bit_cast<double>(middle)) >= k) { reaching = middle; }
+        else { below = middle; }
+      }
+      thresholds[k] = std::bit_cast<double>(reaching);
+    }
+    int level = 0;
+    for (int i = 0; i <= buckets; ++i) {
+      const double start = static_cast<double>(i) / buckets;
+      while (start >= thresholds[level + 1]) { ++level; }
+      bucket_levels[i] = static_cast<uint8_t>(level);
+    }
+  }
+
+  const gray_table & gray_levels() noexcept {
+    static const gray_table table;
+    return table;
+  }
+
 }
\ No newline at end of file
@@ -3,10 +3,30 @@
 
 #include "common/pixel.hpp"
 
+#include <algorithm>
+#include <array>
+
 namespace images::common {
 
   static constexpr double intensity_max_value = 255.0;
 
+  // Intensity transform: c / intensity_divisor1 up to intensity_threshold, and from there
+  // ((c + intensity_delta) / intensity_divisor2)^intensity_exponent
+  constexpr double intensity_threshold = 0.04045;
+  constexpr double intensity_divisor1 = 12.92;
+  constexpr double intensity_divisor2 = 1.055;
+  constexpr double intensity_delta = 0.055;
+  constexpr double intensity_exponent = 2.4;
+
+  // Gamma correction: intensity_divisor1 g up to gamma_threshold, and from there
+  // intensity_divisor2 g^intensity_exponent_inv - intensity_delta
+  constexpr double intensity_exponent_inv = 1.0 / intensity_exponent;
+  constexpr double gamma_threshold = 0.003108;
+
+  constexpr double red_coefficient = 0.2126;
+  constexpr double green_coefficient = 0.7152;
+  constexpr double blue_coefficient = 0.0722;
+
   class normalized_pixel {
   public:
     normalized_pixel(uint8_t r, uint8_t g, uint8_t b) noexcept: color{b / intensity_max_value,
@@ -30,6 +50,39 @@ namespace images::common {
   double gamma_correction(double g) noexcept;
   uint8_t gray_denormalize(double g) noexcept;
 
+  // to_gray_corrected by table lookup. The weighted linear intensity of each channel level is
+  // precomputed and summed in the same order as normalized_pixel::to_gray, so the linear gray
+  // level is the same double. gamma_correction and gray_denormalize are replaced by the least
+  // linear gray level reaching each output level, found by bisection over doubles.
+  class gray_table {
+  public:
+    // Linear gray levels are split in buckets narrower than the gap between two thresholds, so
+    // the lookup adds at most one level to that of the start of the bucket
+    static constexpr int buckets = 4096;
+    static constexpr int levels = 256;
+
+    gray_table() noexcept;
+
+    [[nodiscard]] uint8_t operator()(uint8_t r, uint8_t g, uint8_t b) const noexcept {
+      const double gray = red[r] + green[g] + blue[b];
+      const auto bucket = std::min(static_cast<int>(gray * buckets), buckets);
+      int level = bucket_levels[bucket];
+      while (gray >= thresholds[level + 1]) { ++level; }
+      return static_cast<uint8_t>(level);
+    }
+
+  private:
+    std::array<double, levels> red{};
+    std::array<double, levels> green{};
+    std::array<double, levels> blue{};
+    // Least linear gray level giving each output level, and infinity past the last one
+    std::array<double, levels + 1> thresholds{};
+    std::array<uint8_t, buckets + 1> bucket_levels{};
+  };
+
+  // Table shared by all conversions, built on first use
+  const gray_table & gray_levels() noexcept;
+
 }
 
 #endif //IMAGES_COMMON_NORMALIZED_PIXEL_HPP
@@ -9,11 +9,7 @@ namespace images::common {
   }
 
   uint8_t to_gray_corrected(uint8_t r, uint8_t g, uint8_t b) noexcept {
-    auto real_pixel = normalized_pixel(r, g, b);
-    real_pixel.intensity_transform();
-    const double gray = real_pixel.to_gray();
-    const double gray_gamma = gamma_correction(gray);
-    return gray_denormalize(gray_gamma);
+    return gray_levels()(r, g, b);
   }
 
   void pixel::read(std::istream & is) noexcept {
@@ -0,0 +1,341 @@
+#include "planar.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace {
+  using namespace images::common;
+
+  // Vector kernels work on blocks of 16 pixels, that is three 16-byte chunks of packed BGR
+  constexpr std::size_t block_pixels = 16;
+  constexpr int chunk_bytes = 16;
+
+  using shuffle_mask = std::array<int8_t, chunk_bytes>;
+  using shuffle_masks = std::array<std::array<shuffle_mask, num_channels>, num_channels>;
+
+  // Byte shuffle taking channel ch out of chunk k of a block (-1 zeroes the lane)
+  constexpr shuffle_mask split_mask(int ch, int k) noexcept {
+    shuffle_mask mask{};
+    for (int p = 0; p < chunk_bytes; ++p) {
+      const int i = p * num_channels + ch;
+      mask.at(p) = static_cast<int8_t>(i / chunk_bytes == k ? i % chunk_bytes : -1);
+    }
+    return mask;
+  }
+
+  // Byte shuffle placing the bytes of plane ch that belong to chunk k of a block
+  constexpr shuffle_mask merge_mask(int ch, int k) noexcept {
+    shuffle_mask mask{};
+    for (int q = 0; q < chunk_bytes; ++q) {
+      const int i = k * chunk_bytes + q;
+      mask.at(q) = static_cast<int8_t>(i % num_channels == ch ? i / num_channels : -1);
+    }
+    return mask;
+  }
+
+  constexpr shuffle_masks make_masks(auto make) noexcept {
+    shuffle_masks masks{};
+    for (int ch = 0; ch < num_channels; ++ch) {
+      for (int k = 0; k < num_channels; ++k) {
+        masks.at(ch).at(k) = make(ch, k);
+      }
+    }
+    return masks;
+  }
+
+  // Bits of a byte comparison mask, over width bytes from offset into a block, set for the bytes
+  // that must equal the next one: blue and green of each triplet
+  constexpr uint32_t neighbour_mask(int offset, int width) noexcept {
+    uint32_t mask = 0;
+    for (int q = 0; q < width; ++q) {
+      if ((offset + q) % num_channels != red_channel) { mask |= uint32_t{1} << q; }
+    }
+    return mask;
+  }
+
+  // Indexed as [channel][chunk]
+  alignas(chunk_bytes) constexpr shuffle_masks split_masks = make_masks(split_mask);
+  alignas(chunk_bytes) constexpr shuffle_masks merge_masks = make_masks(merge_mask);
+
+  void deinterleave_scalar(const uint8_t * bgr, plane_pointers planes, std::size_t first,
+      std::size_t count) noexcept {
+    for (std::size_t p = first; p < count; ++p) {
+      for (int ch = 0; ch < num_channels; ++ch) {
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        planes.at(ch)[p] = bgr[p * num_channels + ch];
+      }
+    }
+  }
+
+  // NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+  bool is_gray_scalar(const uint8_t * bgr, std::size_t first, std::size_t count) noexcept {
+    for (std::size_t p = first; p < count; ++p) {
+      const uint8_t * x = bgr + p * num_channels;
+      if (x[0] != x[1] or x[1] != x[2]) { return false; }
+    }
+    return true;
+  }
+
+  bool planes_equal_scalar(const_plane_pointers planes, std::size_t first, std::size_t count)
+  noexcept {
+    for (std::size_t p = first; p < count; ++p) {
+      if (planes[0][p] != planes[1][p] or planes[1][p] != planes[2][p]) { return false; }
+    }
+    return true;
+  }
+  // NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+
+  void interleave_scalar(const_plane_pointers planes, uint8_t * bgr, std::size_t first,
+      std::size_t count) noexcept {
+    for (std::size_t p = first; p < count; ++p) {
+      for (int ch = 0; ch < num_channels; ++ch) {
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        bgr[p * num_channels + ch] = planes.at(ch)[p];
+      }
+    }
+  }
+
+#if defined(__x86_64__) || defined(__i386__)
+
+  // NOLINTBEGIN(cppcoreguidelines-pro-type-reinterpret-cast,cppcoreguidelines-pro-bounds-pointer-arithmetic)
+  [[gnu::target("ssse3")]] inline __m128i load128(const void * p) noexcept {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+  }
+
+  [[gnu::target("ssse3")]] inline void store128(void * p, __m128i v) noexcept {
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(p), v);
+  }
+
+  [[gnu::target("avx2")]] inline __m256i load256(const void * p) noexcept {
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+  }
+
+  [[gnu::target("avx2")]] inline void store256(void * p, __m256i v) noexcept {
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(p), v);
+  }
+
+  [[gnu::target("avx2")]] inline __m256i broadcast128(const void * p) noexcept {
+    return _mm256_broadcastsi128_si256(load128(p));
+  }
+
+  [[gnu::target("ssse3")]]
+  std::size_t deinterleave_sse4(const uint8_t * bgr, plane_pointers planes, std::size_t count)
+  noexcept {
+    std::size_t p = 0;
+    for (; p + block_pixels <= count; p += block_pixels) {
+      const uint8_t * block = bgr + p * num_channels;
+      const __m128i chunk0 = load128(block);
+      const __m128i chunk1 = load128(block + chunk_bytes);
+      const __m128i chunk2 = load128(block + 2 * chunk_bytes);
+      for (int ch = 0; ch < num_channels; ++ch) {
+        const auto & masks = split_masks.at(ch);
+        const __m128i plane = _mm_or_si128(
+            _mm_or_si128(_mm_shuffle_epi8(chunk0, load128(masks[0].data())),
+                _mm_shuffle_epi8(chunk1, load128(masks[1].data()))),
+            _mm_shuffle_epi8(chunk2, load128(masks[2].data())));
+        store128(planes.at(ch) + p, plane);
+      }
+    }
+    return p;
+  }
+
+  [[gnu::target("ssse3")]]
+  std::size_t interleave_sse4(const_plane_pointers planes, uint8_t * bgr, std::size_t count)
+  noexcept {
+    std::size_t p = 0;
+    for (; p + block_pixels <= count; p += block_pixels) {
+      const __m128i blue = load128(planes[0] + p);
+      const __m128i green = load128(planes[1] + p);
+      const __m128i red = load128(planes[2] + p);
+      uint8_t * block = bgr + p * num_channels;
+      for (int k = 0; k < num_channels; ++k) {
+        const __m128i chunk = _mm_or_si128(
+            _mm_or_si128(_mm_shuffle_epi8(blue, load128(merge_masks[0].at(k).data())),
+                _mm_shuffle_epi8(green, load128(merge_masks[1].at(k).data()))),
+            _mm_shuffle_epi8(red, load128(merge_masks[2].at(k).data())));
+        store128(block + k * chunk_bytes, chunk);
+      }
+    }
+    return p;
+  }
+
+  // The vector scans compare each byte with the next one, so a block is only checked when the
+  // byte after it exists. They stop at the first block with a colour pixel and leave it to the
+  // scalar scan.
+  [[gnu::target("ssse3")]]
+  std::size_t is_gray_sse4(const uint8_t * bgr, std::size_t count) noexcept {
+    std::size_t p = 0;
+    for (; p + block_pixels < count; p += block_pixels) {
+      const uint8_t * block = bgr + p * num_channels;
+      for (int k = 0; k < num_channels; ++k) {
+        const uint8_t * chunk = block + k * chunk_bytes;
+        const auto equal = static_cast<uint32_t>(
+            _mm_movemask_epi8(_mm_cmpeq_epi8(load128(chunk), load128(chunk + 1))));
+        const uint32_t needed = neighbour_mask(k * chunk_bytes, chunk_bytes);
+        if ((equal & needed) != needed) { return p; }
+      }
+    }
+    return p;
+  }
+
+  [[gnu::target("ssse3")]]
+  std::size_t planes_equal_sse4(const_plane_pointers planes, std::size_t count) noexcept {
+    std::size_t p = 0;
+    for (; p + chunk_bytes <= count; p += chunk_bytes) {
+      const __m128i green = load128(planes[1] + p);
+      const __m128i equal = _mm_and_si128(_mm_cmpeq_epi8(load128(planes[0] + p), green),
+          _mm_cmpeq_epi8(green, load128(planes[2] + p)));
+      if (_mm_movemask_epi8(equal) != 0xffff) { return p; }
+    }
+    return p;
+  }
+
+  [[gnu::target("avx2")]]
+  std::size_t is_gray_avx2(const uint8_t * bgr, std::size_t count) noexcept {
+    constexpr int wide_chunk = 2 * chunk_bytes;
+    std::size_t p = 0;
+    for (; p + 2 * block_pixels < count; p += 2 * block_pixels) {
+      const uint8_t * block = bgr + p * num_channels;
+      for (int k = 0; k < num_channels; ++k) {
+        const uint8_t * chunk = block + k * wide_chunk;
+        const auto equal = static_cast<uint32_t>(
+            _mm256_movemask_epi8(_mm256_cmpeq_epi8(load256(chunk), load256(chunk + 1))));
+        const uint32_t needed = neighbour_mask(k * wide_chunk, wide_chunk);
+        if ((equal & needed) != needed) { return p; }
+      }
+    }
+    return p;
+  }
+
+  [[gnu::target("avx2")]]
+  std::size_t planes_equal_avx2(const_plane_pointers planes, std::size_t count) noexcept {
+    constexpr std::size_t wide_chunk = 2 * chunk_bytes;
+    std::size_t p = 0;
+    for (; p + wide_chunk <= count; p += wide_chunk) {
+      const __m256i green = load256(planes[1] + p);
+      const __m256i equal = _mm256_and_si256(_mm256_cmpeq_epi8(load256(planes[0] + p), green),
+          _mm256_cmpeq_epi8(green, load256(planes[2] + p)));
+      if (_mm256_movemask_epi8(equal) != -1) { return p; }
+    }
+    return p;
+  }
+
+  // Each 128-bit lane holds its own block of 16 pixels, so the SSE masks are reused per lane
+  [[gnu::target("avx2")]]
+  std::size_t deinterleave_avx2(const uint8_t * bgr, plane_pointers planes, std::size_t count)
+  noexcept {
+    std::size_t p = 0;
+    for (; p + 2 * block_pixels <= count; p += 2 * block_pixels) {
+      const uint8_t * block = bgr + p * num_channels;
+      const __m256i lo = load256(block);
+      const __m256i mid = load256(block + 2 * chunk_bytes);
+      const __m256i hi = load256(block + 4 * chunk_bytes);
+      const __m256i chunk0 = _mm256_permute2x128_si256(lo, mid, 0x30);
+      const __m256i chunk1 = _mm256_permute2x128_si256(lo, hi, 0x21);
+      const __m256i chunk2 = _mm256_permute2x128_si256(mid, hi, 0x30);
+      for (int ch = 0; ch < num_channels; ++ch) {
+        const auto & masks = split_masks.at(ch);
+        const __m256i plane = _mm256_or_si256(
+            _mm256_or_si256(_mm256_shuffle_epi8(chunk0, broadcast128(masks[0].data())),
+                _mm256_shuffle_epi8(chunk1, broadcast128(masks[1].data()))),
+            _mm256_shuffle_epi8(chunk2, broadcast128(masks[2].data())));
+        store256(planes.at(ch) + p, plane);
+      }
+    }
+    return p;
+  }
+
+  [[gnu::target("avx2")]]
+  inline __m256i merge_chunk(__m256i blue, __m256i green, __m256i red, int k) noexcept {
+    return _mm256_or_si256(
+        _mm256_or_si256(_mm256_shuffle_epi8(blue, broadcast128(merge_masks[0].at(k).data())),
+            _mm256_shuffle_epi8(green, broadcast128(merge_masks[1].at(k).data()))),
+        _mm256_shuffle_epi8(red, broadcast128(merge_masks[2].at(k).data())));
+  }
+
+  [[gnu::target("avx2")]]
+  std::size_t interleave_avx2(const_plane_pointers planes, uint8_t * bgr, std::size_t count)
+  noexcept {
+    std::size_t p = 0;
+    for (; p + 2 * block_pixels <= count; p += 2 * block_pixels) {
+      const __m256i blue = load256(planes[0] + p);
+      const __m256i green = load256(planes[1] + p);
+      const __m256i red = load256(planes[2] + p);
+      const __m256i chunk0 = merge_chunk(blue, green, red, 0);
+      const __m256i chunk1 = merge_chunk(blue, green, red, 1);
+      const __m256i chunk2 = merge_chunk(blue, green, red, 2);
+      uint8_t * block = bgr + p * num_channels;
+      store256(block, _mm256_permute2x128_si256(chunk0, chunk1, 0x20));
+      store256(block + 2 * chunk_bytes, _mm256_permute2x128_si256(chunk2, chunk0, 0x30));
+      store256(block + 4 * chunk_bytes, _mm256_permute2x128_si256(chunk1, chunk2, 0x31));
+    }
+    return p;
+  }
+  // NOLINTEND(cppcoreguidelines-pro-type-reinterpret-cast,cppcoreguidelines-pro-bounds-pointer-arithmetic)
+
+#endif
+
+}
+
+namespace images::common {
+
+  void deinterleave_bgr(std::span<const uint8_t> bgr, plane_pointers planes,
+      [[maybe_unused]] simd_level level) noexcept {
+    const std::size_t count = bgr.size() / num_channels;
+    std::size_t done = 0;
+#if defined(__x86_64__) || defined(__i386__)
+    if (level >= simd_level::avx2) {
+      done = deinterleave_avx2(bgr.data(), planes, count);
+    }
+    else if (level == simd_level::sse4) {
+      done = deinterleave_sse4(bgr.data(), planes, count);
+    }
+#endif
+    deinterleave_scalar(bgr.data(), planes, done, count);
+  }
+
+  void interleave_bgr(const_plane_pointers planes, std::span<uint8_t> bgr,
+      [[maybe_unused]] simd_level level) noexcept {
+    const std::size_t count = bgr.size() / num_channels;
+    std::size_t done = 0;
+#if defined(__x86_64__) || defined(__i386__)
+    if (level >= simd_level::avx2) {
+      done = interleave_avx2(planes, bgr.data(), count);
+    }
+    else if (level == simd_level::sse4) {
+      done = interleave_sse4(planes, bgr.data(), count);
+    }
+#endif
+    interleave_scalar(planes, bgr.data(), done, count);
+  }
+
+  bool is_gray_bgr(std::span<const uint8_t> bgr, [[maybe_unused]] simd_level level) noexcept {
+    const std::size_t count = bgr.size() / num_channels;
+    std::size_t done = 0;
+#if defined(__x86_64__) || defined(__i386__)
+    if (level >= simd_level::avx2) {
+      done = is_gray_avx2(bgr.data(), count);
+    }
+    else if (level == simd_level::sse4) {
+      done = is_gray_sse4(bgr.data(), count);
+    }
+#endif
+    return is_gray_scalar(bgr.data(), done, count);
+  }
+
+  bool planes_equal(const_plane_pointers planes, std::size_t count,
+      [[maybe_unused]] simd_level level) noexcept {
+    std::size_t done = 0;
+#if defined(__x86_64__) || defined(__i386__)
+    if (level >= simd_level::avx2) {
+      done = planes_equal_avx2(planes, count);
+    }
+    else if (level == simd_level::sse4) {
+      done = planes_equal_sse4(planes, count);
+    }
+#endif
+    return planes_equal_scalar(planes, done, count);
+  }
+
+}
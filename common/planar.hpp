@@ -0,0 +1,35 @@
+#ifndef IMAGES_COMMON_PLANAR_HPP
+#define IMAGES_COMMON_PLANAR_HPP
+
+#include "common/pixel.hpp"
+#include "common/simd.hpp"
+
+#include <array>
+#include <cstdint>
+#include <span>
+
+namespace images::common {
+
+  // Planes are indexed by channel (blue_channel, green_channel, red_channel)
+  using plane_pointers = std::array<uint8_t *, num_channels>;
+  using const_plane_pointers = std::array<const uint8_t *, num_channels>;
+
+  // Splits packed BGR triplets into one plane per channel
+  void deinterleave_bgr(std::span<const uint8_t> bgr, plane_pointers planes,
+      simd_level level = detected_simd_level()) noexcept;
+
+  // Packs one plane per channel back into BGR triplets
+  void interleave_bgr(const_plane_pointers planes, std::span<uint8_t> bgr,
+      simd_level level = detected_simd_level()) noexcept;
+
+  // Whether every packed BGR triplet has three equal channels; stops at the first that has not
+  bool is_gray_bgr(std::span<const uint8_t> bgr, simd_level level = detected_simd_level())
+  noexcept;
+
+  // Whether the three planes hold the same count bytes; stops at the first pixel that differs
+  bool planes_equal(const_plane_pointers planes, std::size_t count,
+      simd_level level = detected_simd_level()) noexcept;
+
+}
+
+#endif //IMAGES_COMMON_PLANAR_HPP
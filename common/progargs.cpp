@@ -2,6 +2,8 @@
 #include <iostream>
 #include <filesystem>
 #include <map>
+#include <algorithm>
+#include <charconv>
 #include <optional>
 
 namespace {
@@ -14,13 +16,70 @@ namespace {
       {"histo"sv, subcommand::histo},
       {"mono"sv,  subcommand::mono},
       {"gauss"sv, subcommand::gauss},
+      {"box"sv, subcommand::box},
+      {"sharpen"sv, subcommand::sharpen},
+      {"emboss"sv, subcommand::emboss},
+      {"blur"sv, subcommand::blur},
       {"info"sv,  subcommand::info},
+      {"verify-gray"sv, subcommand::verify_gray},
   };
 
+  // Appended to the program name to name the file of autotuned schedules
+  constexpr std::string_view schedule_file_extension = ".schedule";
+
+  // Most repetitions accepted in gauss:N
+  constexpr int max_gauss_repeat = 100;
+
+  // Widest gaussian accepted in blur:SIGMA, in pixels
+  constexpr double max_blur_sigma = 1000;
+
+  // One entry of an operation chain
+  struct chain_entry {
+    std::optional<subcommand> op;
+    int repeat = 1;
+    std::optional<double> sigma;
+  };
+
+  // An operation name, gauss:N for N gauss operations in a row, or blur:SIGMA
+  chain_entry to_chain_entry(std::string_view name) noexcept {
+    const auto colon = name.find(':');
+    if (colon == std::string_view::npos) { return {to_subcommand(name), 1, std::nullopt}; }
+    const auto op = to_subcommand(name.substr(0, colon));
+    const auto argument = name.substr(colon + 1);
+    const char * end = argument.data() + argument.size();
+    if (op == subcommand::gauss) {
+      int repeat = 0;
+      const auto [last, error] = std::from_chars(argument.data(), end, repeat);
+      if (error == std::errc{} and last == end and repeat >= 1 and repeat <= max_gauss_repeat) {
+        return {op, repeat, std::nullopt};
+      }
+    }
+    if (op == subcommand::blur) {
+      double sigma = 0;
+      const auto [last, error] = std::from_chars(argument.data(), end, sigma);
+      if (error == std::errc{} and last == end and sigma > 0 and sigma <= max_blur_sigma) {
+        return {op, 1, sigma};
+      }
+    }
+    return {};
+  }
+
   void print_format_help(std::ostream & os, std::string_view prog_name) noexcept {
     const std::filesystem::path prog{prog_name};
-    os << "  " << prog.filename().native() << " in_path out_path oper\n";
-    os << "    operation: copy, histo, mono, gauss, info\n";
+    os << "  " << prog.filename().native() << " in_path out_path oper [options]\n";
+    os << "    operation: copy, histo, mono, gauss, box, sharpen, emboss, blur, info\n";
+    os << "    chain: operations separated by commas, such as gauss,mono,histo; histo may only\n";
+    os << "      come last and info cannot be chained; gauss:N blurs N times\n";
+    os << "    blur:SIGMA blurs with a gaussian of SIGMA pixels, " << default_blur_sigma
+       << " by default\n";
+    os << "    options: --approx-gauss, --schedule=KIND[:CHUNK], --autotune, --gray-palette\n";
+    os << "      KIND is static, dynamic or guided; --autotune times them on the first image\n";
+    os << "      of each size and keeps the fastest in " << prog.filename().native()
+       << schedule_file_extension << "\n";
+    os << "      --gray-palette stores gray results with 8 bits per pixel and a gray palette\n";
+    os << "  " << prog.filename().native() << " verify-gray\n";
+    os << "    checks the gray conversion of every instruction set of this CPU against the\n";
+    os << "    formula and prints each colour it gets wrong\n";
   }
 
   void error_format(std::ostream & os, std::string_view prog_name) noexcept {
@@ -36,6 +95,13 @@ namespace {
     std::exit(-1);
   }
 
+  void error_invalid_option(std::ostream & os, std::string_view prog_name,
+      std::string_view option) noexcept {
+    os << "Unexpected option:" << option << "\n";
+    print_format_help(os, prog_name);
+    std::exit(-1);
+  }
+
   void error_input_missing(std::ostream & os, std::string_view prog_name, std::string_view in,
       std::string_view out) noexcept {
     os << "Input path: " << in << "\n";
@@ -65,10 +131,20 @@ namespace images::common {
     return value;
   }
 
+  std::string_view to_string(subcommand subcmd) noexcept {
+    for (const auto & [name, value]: subcommand_map) {
+      if (value == subcmd) { return name; }
+    }
+    return {};
+  }
+
   configuration parse_arguments(const std::vector<std::string> & args) noexcept {
     namespace fs = std::filesystem;
 
-    if (std::ssize(args) != 4) {
+    if (std::ssize(args) == 2 and to_subcommand(args[1]) == subcommand::verify_gray) {
+      return {{}, {}, subcommand::verify_gray};
+    }
+    if (std::ssize(args) < 4) {
       error_format(std::cerr, args[0]);
     }
 
@@ -80,11 +156,51 @@ namespace images::common {
     if (!fs::exists(out_path)) {
       error_output_missing(std::cerr, args[0], args[1], args[2]);
     }
-    auto op = to_subcommand(args[3]);
-    subcommand subcmd = subcommand::info;
-    if (!op) { error_invalid_argument(std::cerr, args[0], args[3]); }
-    else { subcmd = *op; }
-    return {in_path, out_path, subcmd};
+    options opts;
+    std::vector<subcommand> chain;
+    std::optional<double> sigma;
+    for (std::size_t first = 0; first <= args[3].size();) {
+      const auto last = std::min(args[3].find(',', first), args[3].size());
+      const auto name = std::string_view{args[3]}.substr(first, last - first);
+      const auto entry = to_chain_entry(name);
+      // A run has a single sigma for all its blurs
+      if (!entry.op or entry.op == subcommand::verify_gray or
+          (entry.sigma and sigma and *sigma != *entry.sigma)) {
+        error_invalid_argument(std::cerr, args[0], name);
+      }
+      else { chain.insert(chain.end(), static_cast<std::size_t>(entry.repeat), *entry.op); }
+      if (entry.sigma) { sigma = entry.sigma; }
+      first = last + 1;
+    }
+    if (sigma) { opts.blur_sigma = *sigma; }
+    const subcommand subcmd = chain.back();
+    chain.pop_back();
+    for (const auto step: chain) {
+      // Only operations giving an image can feed the next one
+      if (step == subcommand::histo or step == subcommand::info) {
+        error_invalid_argument(std::cerr, args[0], args[3]);
+      }
+    }
+    if (subcmd == subcommand::info and !chain.empty()) {
+      error_invalid_argument(std::cerr, args[0], args[3]);
+    }
+    for (std::size_t i = 4; i < args.size(); ++i) {
+      const std::string_view option{args[i]};
+      constexpr std::string_view schedule_option = "--schedule=";
+      if (option == "--approx-gauss") { opts.approximate_gauss = true; }
+      else if (option == "--autotune") { opts.autotune = true; }
+      else if (option == "--gray-palette") { opts.gray_palette = true; }
+      else if (option.starts_with(schedule_option)) {
+        opts.schedule = to_loop_schedule(option.substr(schedule_option.size()));
+        if (!opts.schedule) { error_invalid_option(std::cerr, args[0], option); }
+      }
+      else { error_invalid_option(std::cerr, args[0], option); }
+    }
+    // A given schedule leaves nothing to tune
+    if (opts.autotune and opts.schedule) { error_invalid_option(std::cerr, args[0], "--autotune"); }
+    auto schedule_file = fs::path{args[0]}.filename();
+    schedule_file += schedule_file_extension;
+    return {in_path, out_path, subcmd, opts, chain, schedule_file};
   }
 
 }// namespace images::common
\ No newline at end of file
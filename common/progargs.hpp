@@ -1,6 +1,8 @@
 #ifndef IMAGES_COMMON_PROGARGS_HPP
 #define IMAGES_COMMON_PROGARGS_HPP
 
+#include "schedule.hpp"
+
 #include <optional>
 #include <string_view>
 #include <vector>
@@ -13,15 +15,45 @@ namespace images::common {
     histo,
     mono,
     gauss,
-    info
+    box,
+    sharpen,
+    emboss,
+    blur,
+    info,
+    // Checks the gray kernels of the running CPU; given alone, without paths
+    verify_gray
   };
 
   std::optional<subcommand> to_subcommand(std::string_view str_cmd) noexcept;
 
+  // Name of an operation, as given on the command line
+  std::string_view to_string(subcommand subcmd) noexcept;
+
+  // Standard deviation, in pixels, of blur without a sigma
+  constexpr double default_blur_sigma = 3;
+
+  // Optional flags given after the operation
+  struct options {
+    bool approximate_gauss = false;
+    // Set by blur:SIGMA
+    double blur_sigma = default_blur_sigma;
+    // Set by --schedule=KIND[:CHUNK] or found by --autotune; each kernel has its own default
+    std::optional<loop_schedule> schedule;
+    bool autotune = false;
+    // Images converted to gray are written as 8 bit palettized bitmaps
+    bool gray_palette = false;
+  };
+
   struct configuration {
     std::filesystem::path input_dir;
     std::filesystem::path output_dir;
+    // Last operation of the chain, whose result is written
     subcommand subcmd;
+    options opts{};
+    // Operations applied to the pixels before subcmd, in order; empty for a single operation
+    std::vector<subcommand> steps{};
+    // Schedules found by --autotune, next to where the program is run
+    std::filesystem::path schedule_file{};
   };
 
   configuration parse_arguments(const std::vector<std::string> & args) noexcept;
@@ -0,0 +1,113 @@
+#ifndef IMAGES_COMMON_ROW_BANDS_HPP
+#define IMAGES_COMMON_ROW_BANDS_HPP
+
+#include <algorithm>
+#include <array>
+#include <omp.h>
+#include <type_traits>
+#include <vector>
+
+namespace images::common {
+
+  // Rows first .. last-1 of the image that one band takes
+  struct row_band {
+    int first;
+    int last;
+  };
+
+  // Band band of rows cut into bands bands of nearly the same height
+  inline row_band even_band(int rows, int band, int bands) noexcept {
+    return {static_cast<int>(static_cast<long>(rows) * band / bands),
+            static_cast<int>(static_cast<long>(rows) * (band + 1) / bands)};
+  }
+
+  // Bands given to each thread, so the runtime schedule has some to balance
+  constexpr int bands_per_thread = 4;
+
+  // Bands are kept this many times taller than the rows they share with their neighbours
+  constexpr int band_overlap_ratio = 8;
+
+  // Threads of a team started here: just one inside a parallel region that cannot nest
+  inline int team_size() noexcept {
+    return omp_get_active_level() < omp_get_max_active_levels() ? omp_get_max_threads() : 1;
+  }
+
+  // Bands for rows, each sharing shared_rows rows with its neighbours
+  inline int band_count(int rows, int shared_rows) noexcept {
+    return std::clamp(rows / std::max(1, band_overlap_ratio * shared_rows), 1,
+        team_size() * bands_per_thread);
+  }
+
+  // Slides a window of width rows down rows first .. last-1, calling process(r, window) on each
+  // with the rows fetch(r - width / 2) .. fetch(r + width / 2)
+  template<int width>
+  void slide_window(int first, int last, auto fetch, auto process) noexcept {
+    constexpr int radius = width / 2;
+    if (first >= last) { return; }
+    std::array<std::invoke_result_t<decltype(fetch), int>, width> window{};
+    for (int k = 0; k < width; ++k) {
+      window.at(k) = fetch(first + k - radius);
+    }
+    for (int r = first; r < last; ++r) {
+      if (r > first) {
+        for (int k = 0; k + 1 < width; ++k) {
+          window.at(k) = window.at(k + 1);
+        }
+        window.back() = fetch(r + radius);
+      }
+      process(r, window);
+    }
+  }
+
+  // Runs a filter of width rows in place over an image of rows rows. The image is cut into bands
+  // of whole rows, which threads take from the runtime schedule; each band prepares its own rows
+  // into a ring of width slots just before they could be overwritten. The first and last
+  // width / 2 rows of every band are prepared up front, before any row is written, for the
+  // neighbouring bands. The extra memory stays at a few rows per band.
+  //   make_slots(count) returns storage for count prepared rows,
+  //   prepare(slots, slot, r) prepares source row r into one of them and returns it,
+  //   process(r, window) writes output row r from the prepared rows r - width / 2 ..
+  //   r + width / 2, which are zero_row outside the image.
+  template<int width>
+  void process_in_bands(int rows, auto zero_row, auto make_slots, auto prepare, auto process)
+  noexcept {
+    constexpr int radius = width / 2;
+    constexpr int saved_per_band = 2 * radius;
+    using row_type = decltype(zero_row);
+    if (rows <= 0) { return; }
+    const int bands = band_count(rows, saved_per_band);
+    auto saved = make_slots(bands * saved_per_band);
+    std::vector<row_type> saved_rows(static_cast<std::size_t>(rows));
+
+#pragma omp parallel default(none) \
+    shared(rows, zero_row, make_slots, prepare, process, bands, saved, saved_rows)
+    {
+#pragma omp for
+      for (int band = 0; band < bands; ++band) {
+        const auto [first, last] = even_band(rows, band, bands);
+        int slot = band * saved_per_band;
+        for (int r = first; r < last; ++r) {
+          if (r < first + radius || r >= last - radius) {
+            saved_rows[r] = prepare(saved, slot++, r);
+          }
+        }
+      }
+
+      auto ring = make_slots(width);
+#pragma omp for schedule(runtime)
+      for (int band = 0; band < bands; ++band) {
+        const auto [first, last] = even_band(rows, band, bands);
+        // Rows of this band go through the ring, rows of other bands come from the saved ones
+        const auto fetch = [&](int r) -> row_type {
+          if (r < 0 || r >= rows) { return zero_row; }
+          if (r < first || r >= last) { return saved_rows[r]; }
+          return prepare(ring, r % width, r);
+        };
+        slide_window<width>(first, last, fetch, process);
+      }
+    }
+  }
+
+}
+
+#endif //IMAGES_COMMON_ROW_BANDS_HPP
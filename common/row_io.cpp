@@ -0,0 +1,74 @@
+#include "row_io.hpp"
+#include "file_error.hpp"
+
+#include <algorithm>
+#include <istream>
+#include <ostream>
+
+namespace {
+  // Large enough to run at page cache bandwidth, small enough to stay out of the way
+  constexpr int band_size = 1 << 22;
+}
+
+namespace images::common {
+
+  int rows_per_band(int row_stride) noexcept {
+    return std::max(1, band_size / std::max(1, row_stride));
+  }
+
+  row_reader::row_reader(std::istream & is, const bitmap_header & header) :
+      row_reader{is, header, rows_per_band(header.row_stride())} { }
+
+  row_reader::row_reader(std::istream & is, const bitmap_header & header, int band_rows) : in{is},
+      row_bytes_{header.row_bytes()}, row_stride_{header.row_stride()},
+      height_{std::max(0, header.height())},
+      band_rows_{std::min(std::max(1, band_rows), height_)} {
+    buffer.resize(static_cast<std::size_t>(band_rows_) * static_cast<std::size_t>(row_stride_));
+  }
+
+  int row_reader::next_band() {
+    const int rows = std::min(band_rows_, height_ - next_row_);
+    if (rows <= 0) { return 0; }
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    in.read(reinterpret_cast<char *>(buffer.data()), static_cast<std::streamsize>(rows) * row_stride_);
+    // The padding of the last row may be missing in files written by other tools
+    const auto expected = static_cast<std::streamsize>(rows) * row_stride_ -
+                          (next_row_ + rows == height_ ? row_stride_ - row_bytes_ : 0);
+    if (in.gcount() < expected) {
+      throw file_error{file_error_kind::cannot_read_pixels};
+    }
+    in.clear(in.rdstate() & ~(std::ios::failbit | std::ios::eofbit));
+    band_start_ = next_row_;
+    next_row_ += rows;
+    return rows;
+  }
+
+  std::span<const uint8_t> row_reader::row(int i) const noexcept {
+    return std::span{buffer}.subspan(static_cast<std::size_t>(i) * row_stride_, row_bytes_);
+  }
+
+  row_writer::row_writer(std::ostream & os, const bitmap_header & header) : out{os},
+      row_bytes_{header.row_bytes()}, row_stride_{header.row_stride()},
+      band_rows_{std::min(rows_per_band(row_stride_), std::max(1, header.height()))} {
+    buffer.resize(static_cast<std::size_t>(band_rows_) * static_cast<std::size_t>(row_stride_));
+  }
+
+  std::span<uint8_t> row_writer::next_row() {
+    if (pending_rows_ == band_rows_) { flush(); }
+    const auto offset = static_cast<std::size_t>(pending_rows_) * row_stride_;
+    ++pending_rows_;
+    return std::span{buffer}.subspan(offset, row_bytes_);
+  }
+
+  void row_writer::flush() {
+    if (pending_rows_ == 0) { return; }
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    out.write(reinterpret_cast<const char *>(buffer.data()),
+        static_cast<std::streamsize>(pending_rows_) * row_stride_);
+    if (!out) {
+      throw file_error{file_error_kind::cannot_write};
+    }
+    pending_rows_ = 0;
+  }
+
+}
@@ -0,0 +1,70 @@
+#ifndef IMAGES_COMMON_ROW_IO_HPP
+#define IMAGES_COMMON_ROW_IO_HPP
+
+#include "common/bitmap_header.hpp"
+
+#include <cstdint>
+#include <iosfwd>
+#include <span>
+#include <vector>
+
+namespace images::common {
+
+  // Reads the pixel array of a bitmap in bands of whole rows. Each band is fetched with a single
+  // stream read into a reusable buffer and rows are handed out without their padding.
+  class row_reader {
+  public:
+    row_reader(std::istream & is, const bitmap_header & header);
+    // Reads bands of at most band_rows rows
+    row_reader(std::istream & is, const bitmap_header & header, int band_rows);
+
+    // Reads the next band and returns the number of rows in it (0 when all rows were read)
+    int next_band();
+
+    // First image row held by the current band
+    [[nodiscard]] int band_start() const noexcept { return band_start_; }
+
+    // Packed BGR bytes of the i-th row of the current band
+    [[nodiscard]] std::span<const uint8_t> row(int i) const noexcept;
+
+  private:
+    std::istream & in;
+    int row_bytes_;
+    int row_stride_;
+    int height_;
+    int band_rows_;
+    int band_start_ = 0;
+    int next_row_ = 0;
+    std::vector<uint8_t> buffer;
+  };
+
+  // Writes the pixel array of a bitmap in bands of whole rows. Rows are filled in a reusable
+  // buffer that already holds the zeroed padding and each band goes out with a single write.
+  class row_writer {
+  public:
+    row_writer(std::ostream & os, const bitmap_header & header);
+
+    // Packed BGR bytes of the next row, to be filled by the caller
+    [[nodiscard]] std::span<uint8_t> next_row();
+
+    // Writes the rows that are still pending in the buffer
+    void flush();
+
+    // Rows held in the buffer before it is written out
+    [[nodiscard]] int band_rows() const noexcept { return band_rows_; }
+
+  private:
+    std::ostream & out;
+    int row_bytes_;
+    int row_stride_;
+    int band_rows_;
+    int pending_rows_ = 0;
+    std::vector<uint8_t> buffer;
+  };
+
+  // Number of rows that fit in a band buffer for rows of the given stride
+  int rows_per_band(int row_stride) noexcept;
+
+}
+
+#endif //IMAGES_COMMON_ROW_IO_HPP
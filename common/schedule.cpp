@@ -0,0 +1,99 @@
+#include "schedule.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <fstream>
+#include <sstream>
+
+namespace {
+  using namespace images::common;
+
+  using namespace std::literals;
+
+  constexpr std::array<std::pair<std::string_view, omp_sched_t>, 3> schedule_kinds{{
+      {"static"sv, omp_sched_static},
+      {"dynamic"sv, omp_sched_dynamic},
+      {"guided"sv, omp_sched_guided},
+  }};
+
+  std::optional<omp_sched_t> to_schedule_kind(std::string_view name) noexcept {
+    for (const auto & [kind_name, kind]: schedule_kinds) {
+      if (kind_name == name) { return kind; }
+    }
+    return std::nullopt;
+  }
+
+}
+
+namespace images::common {
+
+  std::optional<loop_schedule> to_loop_schedule(std::string_view text) noexcept {
+    const auto colon = text.find(':');
+    const auto kind = to_schedule_kind(text.substr(0, colon));
+    if (!kind) { return std::nullopt; }
+    if (colon == std::string_view::npos) { return loop_schedule{*kind, 0}; }
+    const auto chunk_text = text.substr(colon + 1);
+    const char * end = chunk_text.data() + chunk_text.size();
+    int chunk = 0;
+    const auto [last, error] = std::from_chars(chunk_text.data(), end, chunk);
+    if (error != std::errc{} or last != end or chunk < 1) { return std::nullopt; }
+    return loop_schedule{*kind, chunk};
+  }
+
+  std::string to_string(loop_schedule schedule) {
+    std::string text;
+    for (const auto & [kind_name, kind]: schedule_kinds) {
+      if (kind == schedule.kind) { text = kind_name; }
+    }
+    if (schedule.chunk > 0) { text += ":" + std::to_string(schedule.chunk); }
+    return text;
+  }
+
+  scoped_schedule::scoped_schedule(loop_schedule schedule) noexcept {
+    omp_get_schedule(&previous.kind, &previous.chunk);
+    omp_set_schedule(schedule.kind, schedule.chunk);
+  }
+
+  scoped_schedule::~scoped_schedule() { omp_set_schedule(previous.kind, previous.chunk); }
+
+  int size_class(long pixels) noexcept {
+    return static_cast<int>(std::bit_width(static_cast<unsigned long>(std::max(pixels, 0L)))) / 2;
+  }
+
+  schedule_profile::schedule_profile(std::filesystem::path file) : file_{std::move(file)} {
+    std::ifstream in{file_};
+    std::string line;
+    while (std::getline(in, line)) {
+      std::istringstream fields{line};
+      std::string chain;
+      int size = 0;
+      int threads = 0;
+      std::string kind;
+      int chunk = 0;
+      if (!(fields >> chain >> size >> threads >> kind >> chunk)) { continue; }
+      const auto schedule = to_loop_schedule(chunk > 0 ? kind + ":" + std::to_string(chunk) : kind);
+      if (schedule) { entries_[{chain, size, threads}] = *schedule; }
+    }
+  }
+
+  std::optional<loop_schedule> schedule_profile::find(const std::string & chain, int size,
+      int threads) const {
+    const auto it = entries_.find({chain, size, threads});
+    if (it == entries_.end()) { return std::nullopt; }
+    return it->second;
+  }
+
+  void schedule_profile::store(const std::string & chain, int size, int threads,
+      loop_schedule schedule) {
+    entries_[{chain, size, threads}] = schedule;
+    std::ofstream out{file_};
+    for (const auto & [key, value]: entries_) {
+      const auto & [entry_chain, entry_size, entry_threads] = key;
+      const auto kind = to_string({value.kind, 0});
+      out << entry_chain << ' ' << entry_size << ' ' << entry_threads << ' ' << kind << ' '
+          << value.chunk << '\n';
+    }
+  }
+
+}
@@ -0,0 +1,78 @@
+#ifndef IMAGES_COMMON_SCHEDULE_HPP
+#define IMAGES_COMMON_SCHEDULE_HPP
+
+#include <array>
+#include <filesystem>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <omp.h>
+
+namespace images::common {
+
+  // OpenMP schedule of the loops declared schedule(runtime): the rows of to_gray and of the
+  // histograms, the row bands of gauss and of the convolution filters, and the tiles of
+  // gauss_blur_tiled. A chunk of 0 leaves the size to OpenMP.
+  struct loop_schedule {
+    omp_sched_t kind = omp_sched_static;
+    int chunk = 0;
+
+    bool operator==(const loop_schedule &) const noexcept = default;
+  };
+
+  // Parses kind or kind:chunk, with kind one of static, dynamic and guided
+  std::optional<loop_schedule> to_loop_schedule(std::string_view text) noexcept;
+
+  // Inverse of to_loop_schedule
+  std::string to_string(loop_schedule schedule);
+
+  // Schedules tried by the autotuner, the default one first
+  constexpr std::array<loop_schedule, 5> schedule_candidates{{
+      {omp_sched_static, 0},
+      {omp_sched_static, 1},
+      {omp_sched_dynamic, 1},
+      {omp_sched_dynamic, 16},
+      {omp_sched_guided, 1},
+  }};
+
+  // Makes schedule the runtime schedule of the calling thread, and of the parallel regions it
+  // starts, until destroyed
+  class scoped_schedule {
+  public:
+    explicit scoped_schedule(loop_schedule schedule) noexcept;
+    scoped_schedule(const scoped_schedule &) = delete;
+    scoped_schedule & operator=(const scoped_schedule &) = delete;
+    ~scoped_schedule();
+
+  private:
+    loop_schedule previous;
+  };
+
+  // Images whose pixel counts are within a factor of four of each other share a size class
+  int size_class(long pixels) noexcept;
+
+  // Best schedules found for each operation chain, size class and thread count, kept in a text
+  // file with one "chain size_class threads kind chunk" line each
+  class schedule_profile {
+  public:
+    // Reads file if it exists; lines that cannot be parsed are skipped
+    explicit schedule_profile(std::filesystem::path file);
+
+    [[nodiscard]] std::optional<loop_schedule> find(const std::string & chain, int size,
+        int threads) const;
+
+    // Records schedule and rewrites the file. A file that cannot be written only loses the
+    // results for later runs.
+    void store(const std::string & chain, int size, int threads, loop_schedule schedule);
+
+  private:
+    std::filesystem::path file_;
+    std::map<std::tuple<std::string, int, int>, loop_schedule> entries_;
+  };
+
+}
+
+#endif //IMAGES_COMMON_SCHEDULE_HPP
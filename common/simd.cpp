@@ -0,0 +1,48 @@
+#include "simd.hpp"
+
+namespace images::common {
+
+  namespace {
+    simd_level detect() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+      __builtin_cpu_init();
+      if (__builtin_cpu_supports("avx512f") and __builtin_cpu_supports("avx512bw")) {
+        return simd_level::avx512;
+      }
+      if (__builtin_cpu_supports("avx2")) { return simd_level::avx2; }
+      if (__builtin_cpu_supports("ssse3") and __builtin_cpu_supports("sse4.1")) {
+        return simd_level::sse4;
+      }
+#endif
+      return simd_level::scalar;
+    }
+  }
+
+  simd_level detected_simd_level() noexcept {
+    static const simd_level level = detect();
+    return level;
+  }
+
+  std::vector<simd_level> supported_simd_levels() {
+    std::vector<simd_level> levels;
+    for (auto level: {simd_level::scalar, simd_level::sse4, simd_level::avx2, simd_level::avx512}) {
+      if (level <= detected_simd_level()) { levels.push_back(level); }
+    }
+    return levels;
+  }
+
+  std::string_view to_string(simd_level level) noexcept {
+    switch (level) {
+      case simd_level::scalar:
+        return "scalar";
+      case simd_level::sse4:
+        return "sse4";
+      case simd_level::avx2:
+        return "avx2";
+      case simd_level::avx512:
+        return "avx512";
+    }
+    return {};
+  }
+
+}
@@ -0,0 +1,28 @@
+#ifndef IMAGES_COMMON_SIMD_HPP
+#define IMAGES_COMMON_SIMD_HPP
+
+#include <string_view>
+#include <vector>
+
+namespace images::common {
+
+  // Vector instruction sets the kernels can be dispatched to, from narrowest to widest
+  enum class simd_level {
+    scalar,
+    sse4,
+    avx2,
+    avx512
+  };
+
+  // Widest level supported by the running CPU, detected once
+  simd_level detected_simd_level() noexcept;
+
+  // Levels from scalar up to the detected one, all of which the running CPU can run
+  std::vector<simd_level> supported_simd_levels();
+
+  // Name of a level, such as avx2
+  std::string_view to_string(simd_level level) noexcept;
+
+}
+
+#endif //IMAGES_COMMON_SIMD_HPP
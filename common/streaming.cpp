@@ -0,0 +1,71 @@
+#include "streaming.hpp"
+#include "bitmap_header.hpp"
+#include "file_error.hpp"
+#include "gray.hpp"
+#include "normalized_pixel.hpp"
+#include "pixel.hpp"
+#include "row_io.hpp"
+
+#include <fstream>
+#include <vector>
+
+namespace images::common {
+
+  void stream_gray(const std::filesystem::path & in_name, const std::filesystem::path & out_name) {
+    std::ifstream in{in_name};
+    if (!in) {
+      throw file_error{file_error_kind::cannot_open};
+    }
+    bitmap_header header;
+    header.read(in);
+    // Opening the output would truncate the input before a single band is read
+    std::error_code same_error;
+    if (std::filesystem::equivalent(in_name, out_name, same_error)) {
+      throw file_error{file_error_kind::cannot_write};
+    }
+    std::ofstream out{out_name};
+    if (!out) {
+      throw file_error{file_error_kind::cannot_open};
+    }
+    // A gray palette file comes out with 24 bits per pixel, like any other mono output
+    const bool palettized = header.is_gray_palette();
+    const auto out_header = palettized ? header.true_color() : header;
+    out_header.write(out);
+
+    // Both sides use the same band height, so a whole input band fits in the output buffer
+    row_writer writer{out, out_header};
+    row_reader reader{in, header, writer.band_rows()};
+    std::vector<std::span<uint8_t>> out_rows;
+    const auto & gray = gray_levels();
+    const auto & regray = gray_of_gray();
+    for (int rows = reader.next_band(); rows > 0; rows = reader.next_band()) {
+      out_rows.clear();
+      for (int i = 0; i < rows; ++i) {
+        out_rows.push_back(writer.next_row());
+      }
+#pragma omp parallel for default(none) shared(rows, reader, out_rows, gray, palettized, regray)
+      for (int i = 0; i < rows; ++i) {
+        const auto src = reader.row(i);
+        const auto dst = out_rows[i];
+        if (palettized) {
+          for (std::size_t c = 0; c < src.size(); ++c) {
+            const uint8_t gray_level = regray[src[c]];
+            dst[c * num_channels] = gray_level;
+            dst[c * num_channels + 1] = gray_level;
+            dst[c * num_channels + 2] = gray_level;
+          }
+          continue;
+        }
+        for (std::size_t c = 0; c < src.size(); c += num_channels) {
+          const auto gray_level =
+              gray(src[c + red_channel], src[c + green_channel], src[c + blue_channel]);
+          dst[c] = gray_level;
+          dst[c + 1] = gray_level;
+          dst[c + 2] = gray_level;
+        }
+      }
+    }
+    writer.flush();
+  }
+
+}
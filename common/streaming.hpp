@@ -0,0 +1,14 @@
+#ifndef IMAGES_COMMON_STREAMING_HPP
+#define IMAGES_COMMON_STREAMING_HPP
+
+#include <filesystem>
+
+namespace images::common {
+
+  // Converts a bitmap to gray one band of rows at a time. Only two band buffers are ever held in
+  // memory, whatever the size of the image. The output cannot be the input file itself.
+  void stream_gray(const std::filesystem::path & in_name, const std::filesystem::path & out_name);
+
+}
+
+#endif //IMAGES_COMMON_STREAMING_HPP
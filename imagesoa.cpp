@@ -1,4 +1,5 @@
 #include "soa/bitmap_soa.hpp"
+#include "common/gray.hpp"
 #include "common/imgcmd.hpp"
 #include "common/progargs.hpp"
 #include <iostream>
@@ -10,6 +11,7 @@ int main(int argc, char **argv) {
   // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
   const std::vector<std::string> args(argv, argv + argc);
   const auto config = parse_arguments(args);
+  if (config.subcmd == subcommand::verify_gray) { return verify_gray_kernels(std::cout) ? 0 : 1; }
   process<bitmap_soa>(config);
 }
 
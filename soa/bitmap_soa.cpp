@@ -1,5 +1,11 @@
 #include "bitmap_soa.hpp"
 #include "common/file_error.hpp"
+#include "common/gray.hpp"
+#include "common/normalized_pixel.hpp"
+#include "common/planar.hpp"
+#include "common/row_io.hpp"
+#include <algorithm>
+#include <cstring>
 #include <fstream>
 #include <omp.h>
 
@@ -10,6 +16,20 @@ bitmap_soa::bitmap_soa(int w, int h)
                            std::vector<uint8_t>(header.image_size()),
                            std::vector<uint8_t>(header.image_size())} {}
 
+bool bitmap_soa::operator==(const bitmap_soa &other) const noexcept {
+  if (header != other.header) {
+    return false;
+  }
+  if (single_channel == other.single_channel) {
+    return pixels == other.pixels;
+  }
+  const auto &gray = single_channel ? *this : other;
+  const auto &colour = single_channel ? other : *this;
+  return std::ranges::all_of(colour.pixels, [&gray](const std::vector<uint8_t> &plane) {
+    return plane == gray.pixels[gray_plane];
+  });
+}
+
 void bitmap_soa::read(const std::filesystem::path &in_name) {
   std::ifstream in{in_name};
   if (!in) {
@@ -17,138 +37,201 @@ void bitmap_soa::read(const std::filesystem::path &in_name) {
   }
   header.read(in);
 
-  const int extra = (width() * 3) % 4;
-  const int pixels_size = height() * width();
+  // Rows are kept in the gray plane alone for as long as every row read is gray, and the other
+  // planes are filled at the first one with some colour. Rows of a gray palette file are the
+  // levels already.
+  const bool palettized = header.is_gray_palette();
   for (auto &p : pixels) {
-    p.reserve(pixels_size);
+    p = std::vector<uint8_t>{};
   }
-  for (int r = 0; r < height(); ++r) {
-    for (int c = 0; c < width(); ++c) {
-      pixel pixel_value{};
-      pixel_value.read(in);
-      pixels[red_channel].push_back(pixel_value.red());
-      pixels[green_channel].push_back(pixel_value.green());
-      pixels[blue_channel].push_back(pixel_value.blue());
-    }
-    if (extra != 0) {
-      in.ignore(4 - extra);
+  pixels[gray_plane].resize(header.image_size());
+  single_channel = true;
+  row_reader reader{in, header};
+  for (int rows = reader.next_band(); rows > 0; rows = reader.next_band()) {
+    for (int i = 0; i < rows; ++i) {
+      const auto row = reader.row(i);
+      const int first = index(reader.band_start() + i, 0);
+      uint8_t *gray = pixels[gray_plane].data() + first;
+      if (palettized) {
+        std::memcpy(gray, row.data(), row.size());
+        continue;
+      }
+      if (single_channel and is_gray_bgr(row)) {
+        for (int c = 0; c < width(); ++c) {
+          gray[c] = row[c * num_channels];
+        }
+        continue;
+      }
+      if (single_channel) {
+        expand_planes();
+      }
+      deinterleave_bgr(row, {pixels[0].data() + first, pixels[1].data() + first,
+                             pixels[2].data() + first});
     }
   }
+  if (palettized) {
+    header = header.true_color();
+  }
 }
 
-namespace {
-void write_padding(std::ostream &os, int n) noexcept {
-  std::array<uint8_t, 3> pad_pixel{};
-  // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
-  os.write(reinterpret_cast<char *>(pad_pixel.data()), n);
-}
-} // namespace
-
-void bitmap_soa::write(const std::filesystem::path &out_name) {
+void bitmap_soa::write(const std::filesystem::path &out_name, bool gray_palette) {
   std::ofstream out{out_name};
   if (!out) {
     throw file_error{file_error_kind::cannot_open};
   }
 
-  header.write(out);
-  const int padding = (4 - (width() * 3) % 4) % 4;
+  const bool palettized = single_channel and gray_palette;
+  const auto out_header = palettized ? header.gray_palette() : header;
+  out_header.write(out);
+  row_writer writer{out, out_header};
   for (int r = 0; r < height(); ++r) {
-    for (int c = 0; c < width(); ++c) {
-      auto pixel_value = get_pixel(r, c);
-      pixel_value.write(out);
+    const auto row = writer.next_row();
+    if (palettized) {
+      std::memcpy(row.data(), pixels[gray_plane].data() + index(r, 0), row.size());
+    }
+    else {
+      interleave_bgr(row_planes(r), row);
     }
-    write_padding(out, padding);
   }
+  writer.flush();
 }
 
 void bitmap_soa::to_gray() noexcept {
-  {
-    const auto max = header.image_size();
-#pragma omp parallel for default(none) shared(max)
-      for (long i = 0; i < max; ++i) {
-        const auto gray_level =
-            to_gray_corrected(pixels[red_channel][i], pixels[green_channel][i],
-                              pixels[blue_channel][i]);
-        pixels[red_channel][i] = gray_level;
-        pixels[green_channel][i] = gray_level;
-        pixels[blue_channel][i] = gray_level;
-      }
+  const int rows = height();
+  if (single_channel) {
+#pragma omp parallel for schedule(runtime) default(none) shared(rows)
+    for (int r = 0; r < rows; ++r) {
+      gray_plane_to_gray(std::span{pixels[gray_plane]}.subspan(index(r, 0), width()));
     }
+    return;
+  }
+#pragma omp parallel for schedule(runtime) default(none) shared(rows)
+  for (int r = 0; r < rows; ++r) {
+    row_to_gray(r);
+  }
+  drop_color_planes();
 }
 
 bool bitmap_soa::is_gray() const noexcept {
-  const auto max = std::ssize(pixels);
-  for (int i = 0; i < max; ++i) {
-    const auto p = get_pixel(i);
-    if (!p.is_gray()) {
-      return false;
-    }
+  if (single_channel) {
+    return true;
   }
-  return true;
-}
-
-namespace {
-constexpr std::array<int, 25> gauss_kernel{1,  4, 7,  4,  1,  4, 16, 26, 16,
-                                           4,  7, 26, 41, 26, 7, 4,  16, 26,
-                                           16, 4, 1,  4,  7,  4, 1};
-
-constexpr int gauss_norm = 273;
-constexpr auto gauss_size = std::ssize(gauss_kernel);
-} // namespace
-
-    void bitmap_soa::gauss() noexcept {
-      bitmap_soa result{*this};
-      const auto num_pixels = std::ssize(pixels[red_channel]);
-#pragma omp parallel default(none) shared(num_pixels, result, gauss_kernel)
-      {
-        const auto [pixels_width, pixels_height] = get_size();
-#pragma omp for
-        for (int pixel_index = 0; pixel_index < num_pixels; ++pixel_index) {
-          const auto [row, column] = get_pixel_position(pixel_index);
-          color_accumulator accum;
-          for (int gauss_index = 0; gauss_index < gauss_size; ++gauss_index) {
-            const int column_offset = (gauss_index % 5) - 2;
-            const int j = column + column_offset;
-            if (j < 0 || j >= pixels_width) { continue; }
-            const int row_offset = (gauss_index / 5) - 2;
-            const int i = row + row_offset;
-            if (i < 0 || i >= pixels_height) { continue; }
-            // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-constant-array-index)
-            const int gauss_value = gauss_kernel[gauss_index];
-            const auto gauss_pixel_index = index(i, j);
-            accum += get_pixel(gauss_pixel_index) * gauss_value;
-          }
-          result.set_pixel(pixel_index, pixel{accum / gauss_norm});
-        }
-      };
-      *this = result;
-    }
+  return planes_equal({pixels[0].data(), pixels[1].data(), pixels[2].data()},
+                      pixels[0].size());
+}
+
+void bitmap_soa::gauss(gauss_mode mode, int iterations) noexcept {
+  for (auto &plane : active_planes()) {
+    gauss_blur_iterated(plane, height(), width(), 1, iterations, mode);
+  }
+}
+
+void bitmap_soa::filter(convolution_filter kind) noexcept {
+  for (auto &plane : active_planes()) {
+    apply_filter(plane, height(), width(), 1, kind);
+  }
+}
+
+void bitmap_soa::blur(double sigma) noexcept {
+  for (auto &plane : active_planes()) {
+    box_gaussian_blur(plane, height(), width(), 1, sigma);
+  }
+}
+
+void bitmap_soa::gauss_to_gray(gauss_mode mode, int iterations) noexcept {
+  if (single_channel) {
+    gauss(mode, iterations);
+    to_gray();
+    return;
+  }
+  const std::array<std::span<uint8_t>, num_channels> planes{pixels[0], pixels[1], pixels[2]};
+  gauss_blur_planes(planes, height(), width(), iterations, mode, detected_simd_level(),
+      [this](int r) { row_to_gray(r); });
+  drop_color_planes();
+}
+
+// The gray levels overwrite the blue plane, so gauss_to_gray only converts rows that no blur
+// still reads
+void bitmap_soa::row_to_gray(int r) noexcept {
+  planes_to_gray(row_planes(r), pixels[gray_plane].data() + index(r, 0),
+                 static_cast<std::size_t>(width()), gray_kernel_level());
+}
+
+void bitmap_soa::drop_color_planes() noexcept {
+  pixels[green_channel] = std::vector<uint8_t>{};
+  pixels[red_channel] = std::vector<uint8_t>{};
+  single_channel = true;
+}
+
+void bitmap_soa::expand_planes() {
+  pixels[green_channel] = pixels[gray_plane];
+  pixels[red_channel] = pixels[gray_plane];
+  single_channel = false;
+}
+
+std::span<std::vector<uint8_t>> bitmap_soa::active_planes() noexcept {
+  return std::span{pixels}.first(single_channel ? 1 : num_channels);
+}
+
+const_plane_pointers bitmap_soa::row_planes(int r) const noexcept {
+  const int first = index(r, 0);
+  if (single_channel) {
+    const uint8_t *gray = pixels[gray_plane].data() + first;
+    return {gray, gray, gray};
+  }
+  return {pixels[0].data() + first, pixels[1].data() + first, pixels[2].data() + first};
+}
 
 histogram bitmap_soa::generate_histogram() const noexcept {
-  histogram histo;
-  const int pixel_count = width() * height();
-    int i;
-    int nthreads;
-#pragma omp parallel default(none) shared(nthreads)
-    {
-#pragma omp single
-        {
-            nthreads = omp_get_num_threads();
-        }
+  if (single_channel) {
+    return plane_histogram(false);
+  }
+  const int rows = height();
+  histogram_counters counters;
+#pragma omp parallel for schedule(runtime) default(none) shared(rows, counters)
+  for (int r = 0; r < rows; ++r) {
+    counters.count_planes(omp_get_thread_num(), row_planes(r), static_cast<std::size_t>(width()));
+  }
+  return counters.merge();
+}
+
+// Counts the gray plane once for all channels, through to_gray if asked to
+histogram bitmap_soa::plane_histogram(bool to_gray) const noexcept {
+  const int rows = height();
+  histogram_counters counters;
+  const auto & map = gray_of_gray();
+#pragma omp parallel for schedule(runtime) default(none) shared(rows, counters, map, to_gray)
+  for (int r = 0; r < rows; ++r) {
+    const auto levels = std::span{pixels[gray_plane]}.subspan(index(r, 0), width());
+    if (to_gray) {
+      counters.count_gray(omp_get_thread_num(), levels, map);
     }
-    std::vector<histogram> h(nthreads);
-
-#pragma omp parallel default(none) shared(pixel_count, h)
-    {
-#pragma omp for
-        for (i = 0; i < pixel_count; ++i) {
-            h[omp_get_thread_num()].add_red(pixels[red_channel][i]);
-            h[omp_get_thread_num()].add_green(pixels[green_channel][i]);
-            h[omp_get_thread_num()].add_blue(pixels[blue_channel][i]);
-        }
+    else {
+      counters.count_gray(omp_get_thread_num(), levels);
     }
-    histo.merge_histos(h, nthreads);
-  return histo;
+  }
+  return counters.merge();
+}
+
+// Converts a row at a time into a buffer of each thread, as row_to_gray does, and counts the
+// levels once
+histogram bitmap_soa::gray_histogram() const noexcept {
+  if (single_channel) {
+    return plane_histogram(true);
+  }
+  const int rows = height();
+  histogram_counters counters;
+  const auto level = gray_kernel_level();
+#pragma omp parallel default(none) shared(rows, counters, level)
+  {
+    std::vector<uint8_t> levels(static_cast<std::size_t>(width()));
+#pragma omp for schedule(runtime)
+    for (int r = 0; r < rows; ++r) {
+      planes_to_gray(row_planes(r), levels.data(), levels.size(), level);
+      counters.count_gray(omp_get_thread_num(), levels);
+    }
+  }
+  return counters.merge();
 }
 
 void bitmap_soa::print_info(std::ostream &os) const noexcept {
@@ -160,18 +243,28 @@ pixel bitmap_soa::get_pixel(int r, int c) const noexcept {
   return get_pixel(i);
 }
 
-void bitmap_soa::set_pixel(int r, int c, pixel p) noexcept {
+void bitmap_soa::set_pixel(int r, int c, pixel p) {
   auto i = index(r, c);
   set_pixel(i, p);
 }
 
 pixel bitmap_soa::get_pixel(int i) const noexcept {
+  if (single_channel) {
+    return pixel{pixels[gray_plane][i], pixels[gray_plane][i], pixels[gray_plane][i]};
+  }
   pixel p{pixels[red_channel][i], pixels[green_channel][i],
           pixels[blue_channel][i]};
   return p;
 }
 
-void bitmap_soa::set_pixel(int i, pixel p) noexcept {
+void bitmap_soa::set_pixel(int i, pixel p) {
+  if (single_channel and p.is_gray()) {
+    pixels[gray_plane][i] = p.red();
+    return;
+  }
+  if (single_channel) {
+    expand_planes();
+  }
   pixels[red_channel][i] = p.red();
   pixels[green_channel][i] = p.green();
   pixels[blue_channel][i] = p.blue();
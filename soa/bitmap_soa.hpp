@@ -6,6 +6,11 @@
 #include "common/bitmap_header.hpp"
 #include "common/pixel.hpp"
 #include "common/histogram.hpp"
+#include "common/gauss.hpp"
+#include "common/convolution.hpp"
+#include "common/box_blur.hpp"
+#include "common/planar.hpp"
+#include <span>
 #include <omp.h>
 
 namespace images::soa {
@@ -17,14 +22,26 @@ namespace images::soa {
     explicit bitmap_soa() noexcept = default;
     bitmap_soa(int w, int h);
 
-    bool operator==(const bitmap_soa &) const noexcept = default;
+    // Compares headers and pixel values, whether each image keeps one plane or three
+    bool operator==(const bitmap_soa & other) const noexcept;
 
     void read(const std::filesystem::path & in_name);
-    void write(const std::filesystem::path & out_name);
+    // A gray image is expanded to 24 bits per pixel unless gray_palette asks for 8 bits indexing
+    // a gray palette
+    void write(const std::filesystem::path & out_name, bool gray_palette = false);
 
+    // Images found gray when read, and those converted to gray, keep a single plane until
+    // set_pixel stores a colour
     void to_gray() noexcept;
-    void gauss() noexcept;
+    void gauss(gauss_mode mode = gauss_mode::exact, int iterations = 1) noexcept;
+    void filter(convolution_filter kind) noexcept;
+    // Gaussian blur of standard deviation sigma pixels, approximated by stacked box blurs
+    void blur(double sigma) noexcept;
+    // gauss followed by to_gray, converting each row as soon as it is blurred
+    void gauss_to_gray(gauss_mode mode = gauss_mode::exact, int iterations = 1) noexcept;
     [[nodiscard]] histogram generate_histogram() const noexcept;
+    // Histogram of the image to_gray would give, without converting it
+    [[nodiscard]] histogram gray_histogram() const noexcept;
     void print_info(std::ostream & os) const noexcept;
 
     [[nodiscard]] int width() const noexcept { return header.width(); }
@@ -42,15 +59,26 @@ namespace images::soa {
     [[nodiscard]] bool is_gray() const noexcept;
 
     [[nodiscard]] pixel get_pixel(int r, int c) const noexcept;
-    void set_pixel(int r, int c, pixel p) noexcept;
+    void set_pixel(int r, int c, pixel p);
 
   private:
+    // Plane that holds the levels of a gray image, the other two being empty
+    static constexpr int gray_plane = blue_channel;
+
     [[nodiscard]] int index(int r, int c) const noexcept;
+    void row_to_gray(int r) noexcept;
+    void drop_color_planes() noexcept;
+    void expand_planes();
+    [[nodiscard]] std::span<std::vector<uint8_t>> active_planes() noexcept;
+    // Row r of each channel; all three are the gray plane of a gray image
+    [[nodiscard]] const_plane_pointers row_planes(int r) const noexcept;
+    [[nodiscard]] histogram plane_histogram(bool to_gray) const noexcept;
     [[nodiscard]] pixel get_pixel(int i) const noexcept;
-    void set_pixel(int i, pixel p) noexcept;
+    void set_pixel(int i, pixel p);
 
     bitmap_header header{};
     std::array<std::vector<uint8_t>, num_channels> pixels;
+    bool single_channel = false;
   };
 
 } // namespace images::soa
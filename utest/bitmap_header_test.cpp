@@ -143,3 +143,58 @@ TEST(bitmap_header, print_info) {
                          "    Extra header size: 46\n";*/
   //EXPECT_EQ(expected, out.view());
 }
+
+TEST(bitmap_header, row_padding) {
+  using images::common::bitmap_header;
+  EXPECT_EQ(0, bitmap_header(4, 1).row_padding());
+  EXPECT_EQ(1, bitmap_header(1, 1).row_padding());
+  EXPECT_EQ(2, bitmap_header(2, 1).row_padding());
+  EXPECT_EQ(3, bitmap_header(3, 1).row_padding());
+  EXPECT_EQ(9, bitmap_header(3, 1).row_bytes());
+  EXPECT_EQ(12, bitmap_header(3, 1).row_stride());
+}
+
+TEST(bitmap_header, gray_palette) {
+  const images::common::bitmap_header header{5, 3};
+  const auto gray = header.gray_palette();
+  EXPECT_EQ(5, gray.width());
+  EXPECT_EQ(3, gray.height());
+  EXPECT_EQ(5, gray.row_bytes());
+  EXPECT_EQ(8, gray.row_stride());
+  EXPECT_EQ(54U + 256 * 4, gray.pixel_start());
+  std::ostringstream out;
+  gray.write(out);
+  const auto bytes = out.str();
+  ASSERT_EQ(54U + 256 * 4, bytes.size());
+  EXPECT_EQ(8, bytes[28]);
+  EXPECT_EQ(40, bytes[14]);
+  // Entry 200 of the palette is the gray level 200
+  for (int i = 0; i < 3; ++i) { EXPECT_EQ(static_cast<char>(200), bytes[54 + 200 * 4 + i]); }
+  EXPECT_EQ(0, bytes[54 + 200 * 4 + 3]);
+}
+
+TEST(bitmap_header, read_gray_palette) {
+  const auto gray = images::common::bitmap_header{5, 3}.gray_palette();
+  std::ostringstream out;
+  gray.write(out);
+  std::istringstream in{out.str()};
+  images::common::bitmap_header header;
+  header.read(in);
+  EXPECT_TRUE(header.is_gray_palette());
+  EXPECT_EQ(gray, header);
+  const auto color = header.true_color();
+  EXPECT_FALSE(color.is_gray_palette());
+  EXPECT_EQ(15, color.row_bytes());
+  EXPECT_EQ(54U, color.pixel_start());
+  EXPECT_EQ(gray, color.gray_palette());
+}
+
+TEST(bitmap_header, read_other_palette) {
+  std::ostringstream out;
+  images::common::bitmap_header{5, 3}.gray_palette().write(out);
+  auto bytes = out.str();
+  bytes[54 + 9 * 4 + 1] = 10; // Green of entry 9
+  std::istringstream in{bytes};
+  images::common::bitmap_header header;
+  EXPECT_THROW(header.read(in), images::common::file_error);
+}
@@ -2,6 +2,9 @@
 #include "aos/bitmap_aos.hpp"
 #include "soa/bitmap_soa.hpp"
 #include "common/file_error.hpp"
+#include "common/imgcmd.hpp"
+#include "common/normalized_pixel.hpp"
+#include "common/schedule.hpp"
 
 template<typename T>
 class bitmap_test : public testing::Test {
@@ -81,6 +84,7 @@ TYPED_TEST(bitmap_test, to_gray) {
   EXPECT_TRUE(fs::exists(infile));
   TypeParam bm;
   bm.read(infile);
+  EXPECT_FALSE(bm.is_gray());
   bm.to_gray();
   EXPECT_TRUE(bm.is_gray());
 }
@@ -111,4 +115,254 @@ TYPED_TEST(bitmap_test, gauss) {
   EXPECT_EQ(pixel(12, 12, 12), bm.get_pixel(0, 1));
   EXPECT_EQ(pixel(3, 3, 3), bm.get_pixel(0, 2));
   EXPECT_EQ(pixel(39, 0, 0), bm.get_pixel(5, 5));
-}
\ No newline at end of file
+}
+
+TYPED_TEST(bitmap_test, gauss_to_gray) {
+  namespace fs = std::filesystem;
+  fs::path infile = fs::current_path() / "../../in" / "sabatini.bmp";
+  TypeParam fused;
+  fused.read(infile);
+  TypeParam separate = fused;
+  TypeParam fused_iterated = fused;
+  TypeParam separate_iterated = fused;
+  fused.gauss_to_gray();
+  separate.gauss();
+  separate.to_gray();
+  EXPECT_EQ(separate, fused);
+  using images::common::gauss_mode;
+  fused_iterated.gauss_to_gray(gauss_mode::exact, 3);
+  separate_iterated.gauss(gauss_mode::exact, 3);
+  separate_iterated.to_gray();
+  EXPECT_EQ(separate_iterated, fused_iterated);
+}
+
+TYPED_TEST(bitmap_test, gray_histogram) {
+  TypeParam bm{4, 4};
+  bm.set_pixel(0, 0, {128, 127, 0});
+  bm.set_pixel(2, 3, {10, 200, 30});
+  bm.set_pixel(3, 3, {255, 255, 255});
+  auto gray = bm;
+  gray.to_gray();
+  const auto expected = gray.generate_histogram();
+  const auto h = bm.gray_histogram();
+  for (int v = 0; v < 256; ++v) {
+    const auto level = static_cast<uint8_t>(v);
+    EXPECT_EQ(expected.get_red_frequency(level), h.get_red_frequency(level)) << v;
+    EXPECT_EQ(expected.get_green_frequency(level), h.get_green_frequency(level)) << v;
+    EXPECT_EQ(expected.get_blue_frequency(level), h.get_blue_frequency(level)) << v;
+  }
+}
+
+TYPED_TEST(bitmap_test, gauss_iterated) {
+  namespace fs = std::filesystem;
+  fs::path infile = fs::current_path() / "../../in" / "sabatini.bmp";
+  TypeParam iterated;
+  iterated.read(infile);
+  TypeParam repeated = iterated;
+  iterated.gauss(images::common::gauss_mode::exact, 3);
+  for (int i = 0; i < 3; ++i) { repeated.gauss(); }
+  EXPECT_EQ(repeated, iterated);
+}
+
+TYPED_TEST(bitmap_test, blur_uniform) {
+  TypeParam bm{30, 20};
+  for (int r = 0; r < 20; ++r) {
+    for (int c = 0; c < 30; ++c) { bm.set_pixel(r, c, {10, 20, 30}); }
+  }
+  auto blurred = bm;
+  blurred.blur(6);
+  EXPECT_EQ(bm, blurred);
+}
+
+TYPED_TEST(bitmap_test, schedule_independent) {
+  TypeParam bm{9, 7};
+  for (int r = 0; r < 7; ++r) {
+    for (int c = 0; c < 9; ++c) {
+      bm.set_pixel(r, c, {static_cast<uint8_t>(r * 37), static_cast<uint8_t>(c * 29),
+                          static_cast<uint8_t>(r * c)});
+    }
+  }
+  auto expected = bm;
+  expected.to_gray();
+  const auto expected_histo = bm.generate_histogram();
+  for (const auto candidate: images::common::schedule_candidates) {
+    const images::common::scoped_schedule schedule{candidate};
+    auto gray = bm;
+    gray.to_gray();
+    EXPECT_EQ(expected, gray) << images::common::to_string(candidate);
+    const auto histo = bm.generate_histogram();
+    for (int v = 0; v < 256; ++v) {
+      const auto level = static_cast<uint8_t>(v);
+      EXPECT_EQ(expected_histo.get_red_frequency(level), histo.get_red_frequency(level)) << v;
+    }
+  }
+}
+
+TYPED_TEST(bitmap_test, gray_single_channel) {
+  TypeParam bm{6, 5};
+  for (int r = 0; r < 5; ++r) {
+    for (int c = 0; c < 6; ++c) {
+      bm.set_pixel(r, c, {static_cast<uint8_t>(r * 50), static_cast<uint8_t>(c * 40), 99});
+    }
+  }
+  auto gray = bm;
+  gray.to_gray();
+  EXPECT_TRUE(gray.is_gray());
+  // The same levels kept in all three channels
+  TypeParam expanded{6, 5};
+  for (int r = 0; r < 5; ++r) {
+    for (int c = 0; c < 6; ++c) { expanded.set_pixel(r, c, gray.get_pixel(r, c)); }
+  }
+  for (const auto kind: {images::common::convolution_filter::box,
+                         images::common::convolution_filter::sharpen}) {
+    auto filtered = gray;
+    filtered.filter(kind);
+    auto expected = expanded;
+    expected.filter(kind);
+    for (int r = 0; r < 5; ++r) {
+      for (int c = 0; c < 6; ++c) { EXPECT_EQ(expected.get_pixel(r, c), filtered.get_pixel(r, c)); }
+    }
+  }
+  gray.gauss();
+  expanded.gauss();
+  for (int r = 0; r < 5; ++r) {
+    for (int c = 0; c < 6; ++c) { EXPECT_EQ(expanded.get_pixel(r, c), gray.get_pixel(r, c)); }
+  }
+  const auto histo = gray.generate_histogram();
+  const auto expected_histo = expanded.generate_histogram();
+  for (int v = 0; v < 256; ++v) {
+    const auto level = static_cast<uint8_t>(v);
+    EXPECT_EQ(expected_histo.get_red_frequency(level), histo.get_red_frequency(level)) << v;
+    EXPECT_EQ(expected_histo.get_green_frequency(level), histo.get_green_frequency(level)) << v;
+    EXPECT_EQ(expected_histo.get_blue_frequency(level), histo.get_blue_frequency(level)) << v;
+  }
+  // A colour brings the other channels back
+  gray.set_pixel(0, 0, {1, 2, 3});
+  EXPECT_FALSE(gray.is_gray());
+  EXPECT_EQ(images::common::pixel(1, 2, 3), gray.get_pixel(0, 0));
+  EXPECT_EQ(expanded.get_pixel(4, 5), gray.get_pixel(4, 5));
+}
+
+TYPED_TEST(bitmap_test, write_gray) {
+  namespace fs = std::filesystem;
+  fs::path infile = fs::current_path() / "../../in" / "sabatini.bmp";
+  fs::path outdir = fs::current_path() / "../../out";
+  fs::create_directory(outdir);
+  TypeParam gray;
+  gray.read(infile);
+  gray.to_gray();
+  gray.write(outdir / "sabatini_gray.bmp");
+  TypeParam written;
+  written.read(outdir / "sabatini_gray.bmp");
+  EXPECT_TRUE(written.is_gray());
+  EXPECT_EQ(gray, written);
+
+  gray.write(outdir / "sabatini_gray8.bmp", true);
+  const auto palette_size = 256 * 4;
+  const auto row_stride = (gray.width() + 3) / 4 * 4;
+  EXPECT_EQ(54 + palette_size + row_stride * gray.height(),
+      fs::file_size(outdir / "sabatini_gray8.bmp"));
+  // The 8-bit file reads back into one channel, with a plain 24-bit header
+  TypeParam palettized;
+  palettized.read(outdir / "sabatini_gray8.bmp");
+  EXPECT_TRUE(palettized.is_gray());
+  int differences = 0;
+  for (int r = 0; r < gray.height(); ++r) {
+    for (int c = 0; c < gray.width(); ++c) {
+      differences += written.get_pixel(r, c) != palettized.get_pixel(r, c) ? 1 : 0;
+    }
+  }
+  EXPECT_EQ(0, differences);
+  palettized.write(outdir / "sabatini_gray24.bmp");
+  const auto colour_stride = (3 * gray.width() + 3) / 4 * 4;
+  EXPECT_EQ(54 + colour_stride * gray.height(), fs::file_size(outdir / "sabatini_gray24.bmp"));
+  TypeParam expanded;
+  expanded.read(outdir / "sabatini_gray24.bmp");
+  EXPECT_EQ(palettized, expanded);
+}
+
+TYPED_TEST(bitmap_test, equal_pixels_in_any_storage) {
+  namespace fs = std::filesystem;
+  fs::path outdir = fs::current_path() / "../../out";
+  fs::create_directory(outdir);
+  TypeParam colour{7, 5};
+  for (int r = 0; r < 5; ++r) {
+    for (int c = 0; c < 7; ++c) {
+      const auto level = static_cast<uint8_t>(r * 7 + c);
+      colour.set_pixel(r, c, {level, level, level});
+    }
+  }
+  colour.write(outdir / "equal_gray.bmp");
+  // A gray file is read into one channel, but holds the same pixels
+  TypeParam gray;
+  gray.read(outdir / "equal_gray.bmp");
+  EXPECT_EQ(colour, gray);
+  EXPECT_EQ(gray, colour);
+  colour.set_pixel(4, 6, {34, 34, 35});
+  EXPECT_NE(colour, gray);
+  EXPECT_NE(gray, colour);
+}
+
+TYPED_TEST(bitmap_test, chain_on_gray) {
+  using enum images::common::subcommand;
+  TypeParam bm{16, 16};
+  for (int r = 0; r < 16; ++r) {
+    for (int c = 0; c < 16; ++c) {
+      bm.set_pixel(r, c, {static_cast<uint8_t>(r * 16), static_cast<uint8_t>(c * 16), 77});
+    }
+  }
+  const images::common::options opts;
+  // The second mono converts the blurred gray levels through the formula again
+  auto blurred = bm;
+  EXPECT_FALSE(images::common::process_chain(blurred, {mono, gauss}, mono, opts));
+  auto expected = bm;
+  expected.to_gray();
+  expected.gauss();
+  for (int r = 0; r < 16; ++r) {
+    for (int c = 0; c < 16; ++c) {
+      const auto level = expected.get_pixel(r, c).red();
+      const auto gray = images::common::to_gray_corrected(level, level, level);
+      EXPECT_EQ(images::common::pixel(gray, gray, gray), blurred.get_pixel(r, c));
+    }
+  }
+  // mono,mono,histo counts the levels of the second conversion
+  auto twice = bm;
+  twice.to_gray();
+  twice.to_gray();
+  const auto expected_histo = twice.generate_histogram();
+  const auto counts = images::common::process_chain(bm, {mono, mono}, histo, opts);
+  ASSERT_TRUE(counts);
+  for (int v = 0; v < 256; ++v) {
+    const auto level = static_cast<uint8_t>(v);
+    EXPECT_EQ(expected_histo.get_red_frequency(level), counts->get_red_frequency(level)) << v;
+    EXPECT_EQ(expected_histo.get_green_frequency(level), counts->get_green_frequency(level)) << v;
+  }
+}
+
+TYPED_TEST(bitmap_test, gray_histogram_of_gray) {
+  TypeParam bm{16, 16};
+  for (int r = 0; r < 16; ++r) {
+    for (int c = 0; c < 16; ++c) {
+      bm.set_pixel(r, c, {static_cast<uint8_t>(r * 16), static_cast<uint8_t>(c * 16), 77});
+    }
+  }
+  auto once = bm;
+  once.to_gray();
+  // Converting a gray image again goes through the formula, which does not keep every level
+  auto twice = once;
+  twice.to_gray();
+  for (int r = 0; r < 16; ++r) {
+    for (int c = 0; c < 16; ++c) {
+      const auto level = once.get_pixel(r, c).red();
+      const auto expected = images::common::to_gray_corrected(level, level, level);
+      EXPECT_EQ(images::common::pixel(expected, expected, expected), twice.get_pixel(r, c));
+    }
+  }
+  const auto histo = once.gray_histogram();
+  const auto expected_histo = twice.generate_histogram();
+  for (int v = 0; v < 256; ++v) {
+    const auto level = static_cast<uint8_t>(v);
+    EXPECT_EQ(expected_histo.get_red_frequency(level), histo.get_red_frequency(level)) << v;
+    EXPECT_EQ(expected_histo.get_blue_frequency(level), histo.get_blue_frequency(level)) << v;
+  }
+}
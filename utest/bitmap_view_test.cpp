@@ -0,0 +1,106 @@
+#include <gtest/gtest.h>
+#include "common/bitmap_view.hpp"
+#include "common/file_error.hpp"
+#include "aos/bitmap_aos.hpp"
+
+TEST(bitmap_view, construct) {
+  const images::common::bitmap_view view;
+  EXPECT_EQ(0, view.width());
+  EXPECT_EQ(0, view.height());
+}
+
+TEST(bitmap_view, read) {
+  namespace fs = std::filesystem;
+  fs::path file = fs::current_path() / "../../in/sabatini.bmp";
+  EXPECT_TRUE(fs::exists(file));
+  images::common::bitmap_view view;
+  view.read(file);
+  EXPECT_EQ(1980, view.width());
+  EXPECT_EQ(1320, view.height());
+  EXPECT_EQ(1980 * 3, std::ssize(view.row(0)));
+  std::ostringstream out;
+  view.print_info(out);
+  EXPECT_EQ("    Width: 1980\n    Height: 1320\n    Pixel start: 138\n"
+            "    Number of planes: 1\n    Bits per pixel: 24\n    Compression: 0\n"
+            "    Extra header size: 84\n", out.str());
+}
+
+TEST(bitmap_view, read_inexistent) {
+  namespace fs = std::filesystem;
+  fs::path file = fs::current_path() / "../../in/none.bmp";
+  EXPECT_FALSE(fs::exists(file));
+  images::common::bitmap_view view;
+  EXPECT_THROW(view.read(file), images::common::file_error);
+  EXPECT_EQ(0, view.width());
+}
+
+TEST(bitmap_view, same_pixels_as_loaded) {
+  namespace fs = std::filesystem;
+  fs::path file = fs::current_path() / "../../in/sabatini.bmp";
+  images::common::bitmap_view view;
+  view.read(file);
+  images::aos::bitmap_aos bm;
+  bm.read(file);
+  for (int r = 0; r < view.height(); r += 7) {
+    for (int c = 0; c < view.width(); c += 5) {
+      ASSERT_EQ(bm.get_pixel(r, c), view.get_pixel(r, c));
+    }
+  }
+  EXPECT_EQ(bm.is_gray(), view.is_gray());
+}
+
+TEST(bitmap_view, histogram) {
+  namespace fs = std::filesystem;
+  fs::path file = fs::current_path() / "../../in/sabatini.bmp";
+  images::common::bitmap_view view;
+  view.read(file);
+  images::aos::bitmap_aos bm;
+  bm.read(file);
+  std::ostringstream view_out;
+  view.generate_histogram().write(view_out);
+  std::ostringstream bm_out;
+  bm.generate_histogram().write(bm_out);
+  EXPECT_EQ(bm_out.str(), view_out.str());
+}
+
+TEST(bitmap_view, gray_rows_histogram) {
+  namespace fs = std::filesystem;
+  fs::path outdir = fs::current_path() / "../../out";
+  fs::create_directory(outdir);
+  // Gray in the upper half only
+  images::aos::bitmap_aos bm{40, 30};
+  for (int r = 0; r < 30; ++r) {
+    for (int c = 0; c < 40; ++c) {
+      const auto level = static_cast<uint8_t>(r * 8 + c);
+      bm.set_pixel(r, c, {level, static_cast<uint8_t>(r < 15 ? level : c), level});
+    }
+  }
+  bm.write(outdir / "half_gray.bmp");
+  images::common::bitmap_view view;
+  view.read(outdir / "half_gray.bmp");
+  EXPECT_FALSE(view.is_gray());
+  std::ostringstream view_out;
+  view.generate_histogram().write(view_out);
+  std::ostringstream bm_out;
+  bm.generate_histogram().write(bm_out);
+  EXPECT_EQ(bm_out.str(), view_out.str());
+}
+
+TEST(bitmap_view, gray_palette_histogram) {
+  namespace fs = std::filesystem;
+  fs::path outdir = fs::current_path() / "../../out";
+  fs::create_directory(outdir);
+  images::aos::bitmap_aos bm;
+  bm.read(fs::current_path() / "../../in/sabatini.bmp");
+  bm.to_gray();
+  bm.write(outdir / "view_gray8.bmp", true);
+  images::common::bitmap_view view;
+  view.read(outdir / "view_gray8.bmp");
+  EXPECT_TRUE(view.is_gray());
+  EXPECT_EQ(bm.get_pixel(7, 11), view.get_pixel(7, 11));
+  std::ostringstream view_out;
+  view.generate_histogram().write(view_out);
+  std::ostringstream bm_out;
+  bm.generate_histogram().write(bm_out);
+  EXPECT_EQ(bm_out.str(), view_out.str());
+}
@@ -0,0 +1,39 @@
+#include <gtest/gtest.h>
+#include "common/bounded_queue.hpp"
+#include <thread>
+#include <vector>
+
+TEST(bounded_queue, push_pop) {
+  images::common::bounded_queue<int> queue{2};
+  queue.push(1);
+  queue.push(2);
+  EXPECT_EQ(1, queue.pop());
+  EXPECT_EQ(2, queue.pop());
+}
+
+TEST(bounded_queue, closed_empty) {
+  images::common::bounded_queue<int> queue{1};
+  queue.push(1);
+  queue.close();
+  EXPECT_EQ(1, queue.pop());
+  EXPECT_EQ(std::nullopt, queue.pop());
+}
+
+TEST(bounded_queue, producer_consumer) {
+  images::common::bounded_queue<int> queue{1};
+  std::thread producer{[&queue] {
+    for (int i = 0; i < 1000; ++i) {
+      queue.push(i);
+    }
+    queue.close();
+  }};
+  std::vector<int> received;
+  while (auto value = queue.pop()) {
+    received.push_back(*value);
+  }
+  producer.join();
+  ASSERT_EQ(1000, std::ssize(received));
+  for (int i = 0; i < 1000; ++i) {
+    EXPECT_EQ(i, received[i]);
+  }
+}
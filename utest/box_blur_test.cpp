@@ -0,0 +1,96 @@
+#include <gtest/gtest.h>
+#include "common/box_blur.hpp"
+#include "utest/test_images.hpp"
+#include <omp.h>
+#include <vector>
+
+namespace {
+
+  using images::test::random_image;
+
+  // Rounded mean over the taps of one channel within radius, rows first and then columns, each
+  // pass over a copy of the image
+  std::vector<uint8_t> reference_box(std::vector<uint8_t> data, int rows, int row_length,
+      int step, int radius) {
+    auto horizontal = data;
+    for (int r = 0; r < rows; ++r) {
+      for (int j = 0; j < row_length; ++j) {
+        int sum = 0;
+        int taps = 0;
+        for (int k = -radius; k <= radius; ++k) {
+          const int c = j + k * step;
+          if (c < 0 || c >= row_length) { continue; }
+          sum += data[r * row_length + c];
+          ++taps;
+        }
+        horizontal[r * row_length + j] = static_cast<uint8_t>((sum + taps / 2) / taps);
+      }
+    }
+    for (int r = 0; r < rows; ++r) {
+      for (int j = 0; j < row_length; ++j) {
+        int sum = 0;
+        int taps = 0;
+        for (int k = -radius; k <= radius; ++k) {
+          const int i = r + k;
+          if (i < 0 || i >= rows) { continue; }
+          sum += horizontal[i * row_length + j];
+          ++taps;
+        }
+        data[r * row_length + j] = static_cast<uint8_t>((sum + taps / 2) / taps);
+      }
+    }
+    return data;
+  }
+
+}
+
+TEST(box_blur, matches_reference) {
+  const int default_threads = omp_get_max_threads();
+  for (int threads: {1, 3, 7}) {
+    omp_set_num_threads(threads);
+    for (int step: {1, 3}) {
+      for (int radius: {1, 2, 7, 40}) {
+        for (auto [rows, columns]: {std::pair{1, 1}, {4, 3}, {17, 33}, {30, 300}}) {
+          const int row_length = columns * step;
+          auto data = random_image(rows * row_length);
+          const auto expected = reference_box(data, rows, row_length, step, radius);
+          images::common::box_blur(data, rows, row_length, step, radius);
+          EXPECT_EQ(expected, data) << threads << " threads, step " << step << ", radius "
+                                    << radius << ", " << rows << "x" << columns;
+        }
+      }
+    }
+  }
+  omp_set_num_threads(default_threads);
+}
+
+TEST(box_blur, gaussian_radii_match_variance) {
+  for (double sigma: {0.8, 1.0, 2.5, 10.0, 57.0}) {
+    const auto radii = images::common::gaussian_box_radii(sigma);
+    double variance = 0;
+    for (const int radius: radii) {
+      const int width = 2 * radius + 1;
+      variance += (width * width - 1) / 12.0;
+    }
+    EXPECT_NEAR(sigma * sigma, variance, 0.1 * sigma * sigma + 0.5) << sigma;
+  }
+}
+
+TEST(box_blur, gaussian_keeps_uniform_image) {
+  std::vector<uint8_t> data(25L * 90, 77);
+  images::common::box_gaussian_blur(data, 25, 90, 3, 12.5);
+  EXPECT_EQ(std::vector<uint8_t>(25L * 90, 77), data);
+}
+
+TEST(box_blur, gaussian_is_stacked_boxes) {
+  auto data = random_image(40 * 120);
+  auto expected = data;
+  for (const int radius: images::common::gaussian_box_radii(4)) {
+    images::common::box_blur(expected, 40, 120, 3, radius);
+  }
+  images::common::box_gaussian_blur(data, 40, 120, 3, 4);
+  // Stacking all row passes before the column passes only changes how results are rounded
+  for (std::size_t i = 0; i < data.size(); ++i) {
+    EXPECT_NEAR(expected[i], data[i], 2) << i;
+  }
+}
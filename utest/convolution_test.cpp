@@ -0,0 +1,80 @@
+#include <gtest/gtest.h>
+#include "common/convolution.hpp"
+#include "common/gauss.hpp"
+#include "utest/test_images.hpp"
+#include <omp.h>
+#include <vector>
+
+namespace {
+
+  using images::test::random_image;
+
+  // Straightforward convolution over a copy of the image
+  template<auto kernel>
+  std::vector<uint8_t> reference_convolve(const std::vector<uint8_t> & data, int rows,
+      int row_length, int step) {
+    std::vector<uint8_t> result(data.size());
+    for (int r = 0; r < rows; ++r) {
+      for (int j = 0; j < row_length; ++j) {
+        long accum = 0;
+        for (int k = 0; k < kernel.width * kernel.width; ++k) {
+          const int i = r + k / kernel.width - kernel.radius;
+          const int c = j + (k % kernel.width - kernel.radius) * step;
+          if (i < 0 || i >= rows || c < 0 || c >= row_length) { continue; }
+          accum += kernel.weights[k] * data[i * row_length + c];
+        }
+        result[r * row_length + j] =
+            static_cast<uint8_t>(std::clamp(accum / kernel.norm, 0L, 255L));
+      }
+    }
+    return result;
+  }
+
+  template<auto kernel>
+  void expect_matches_reference() {
+    const int default_threads = omp_get_max_threads();
+    for (int threads: {1, 2, 7}) {
+      omp_set_num_threads(threads);
+      for (int step: {1, 3}) {
+        for (auto [rows, columns]: {std::pair{1, 1}, {2, 3}, {5, 5}, {9, 4}, {17, 33}}) {
+          const int row_length = columns * step;
+          auto data = random_image(rows * row_length);
+          const auto expected = reference_convolve<kernel>(data, rows, row_length, step);
+          images::common::convolve<kernel>(data, rows, row_length, step);
+          EXPECT_EQ(expected, data) << threads << " threads, step " << step << ", " << rows
+                                    << "x" << columns;
+        }
+      }
+    }
+    omp_set_num_threads(default_threads);
+  }
+
+}
+
+TEST(convolution, box_matches_reference) {
+  expect_matches_reference<images::common::box_kernel>();
+}
+
+TEST(convolution, sharpen_matches_reference) {
+  expect_matches_reference<images::common::sharpen_kernel>();
+}
+
+TEST(convolution, emboss_matches_reference) {
+  expect_matches_reference<images::common::emboss_kernel>();
+}
+
+TEST(convolution, gauss_kernel_matches_gauss_blur) {
+  auto data = random_image(23 * 41 * 3);
+  auto blurred = data;
+  images::common::gauss_blur(blurred, 23, 41 * 3, 3);
+  images::common::convolve<images::common::gauss_kernel>(data, 23, 41 * 3, 3);
+  EXPECT_EQ(blurred, data);
+}
+
+TEST(convolution, apply_filter_uses_kernel) {
+  auto data = random_image(12 * 10);
+  auto expected = data;
+  images::common::convolve<images::common::emboss_kernel>(expected, 12, 10, 1);
+  images::common::apply_filter(data, 12, 10, 1, images::common::convolution_filter::emboss);
+  EXPECT_EQ(expected, data);
+}
@@ -0,0 +1,61 @@
+#include <gtest/gtest.h>
+#include "common/file_copy.hpp"
+#include "common/file_error.hpp"
+#include "aos/bitmap_aos.hpp"
+#include <fstream>
+#include <iterator>
+
+namespace {
+
+  std::string file_contents(const std::filesystem::path & name) {
+    std::ifstream in{name};
+    return {std::istreambuf_iterator<char>{in}, std::istreambuf_iterator<char>{}};
+  }
+
+}
+
+TEST(file_copy, copy_bitmap) {
+  namespace fs = std::filesystem;
+  fs::path infile = fs::current_path() / "../../in/sabatini.bmp";
+  fs::path outdir = fs::current_path() / "../../out";
+  fs::create_directory(outdir);
+  images::common::copy_bitmap(infile, outdir / "sabatini_copy.bmp");
+  images::aos::bitmap_aos bm;
+  bm.read(infile);
+  bm.write(outdir / "sabatini.bmp");
+  EXPECT_EQ(file_contents(outdir / "sabatini.bmp"), file_contents(outdir / "sabatini_copy.bmp"));
+}
+
+TEST(file_copy, copy_invalid) {
+  namespace fs = std::filesystem;
+  fs::path outdir = fs::current_path() / "../../out";
+  fs::create_directory(outdir);
+  const fs::path infile = outdir / "invalid.bmp";
+  std::ofstream{infile} << "not a bitmap";
+  EXPECT_THROW(images::common::copy_bitmap(infile, outdir / "invalid_copy.bmp"),
+      images::common::file_error);
+}
+
+TEST(file_copy, copy_truncated) {
+  namespace fs = std::filesystem;
+  fs::path outdir = fs::current_path() / "../../out";
+  fs::create_directory(outdir);
+  const fs::path infile = outdir / "truncated.bmp";
+  auto data = file_contents(fs::current_path() / "../../in/sabatini.bmp");
+  data.resize(data.size() / 2);
+  std::ofstream{infile} << data;
+  EXPECT_THROW(images::common::copy_bitmap(infile, outdir / "truncated_copy.bmp"),
+      images::common::file_error);
+}
+
+TEST(file_copy, copy_onto_itself) {
+  namespace fs = std::filesystem;
+  fs::path outdir = fs::current_path() / "../../out";
+  fs::create_directory(outdir);
+  const fs::path file = outdir / "self_copy.bmp";
+  fs::copy_file(fs::current_path() / "../../in/sabatini.bmp", file,
+      fs::copy_options::overwrite_existing);
+  const auto before = file_contents(file);
+  images::common::copy_bitmap(file, outdir / "." / "self_copy.bmp");
+  EXPECT_EQ(before, file_contents(file));
+}
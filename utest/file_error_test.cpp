@@ -55,6 +55,12 @@ TEST(file_error_to_string, invalid_pixel_start) {
   EXPECT_EQ("Invalid pixel start", msg);
 }
 
+TEST(file_error_to_string, cannot_read_pixels) {
+  using namespace images::common;
+  auto msg = to_string(file_error_kind::cannot_read_pixels);
+  EXPECT_EQ("Cannot read pixel data", msg);
+}
+
 TEST(file_error_to_string, unkonwn_file_error) {
   using namespace images::common;
   auto msg = to_string(file_error_kind{-1});
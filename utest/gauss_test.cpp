@@ -0,0 +1,295 @@
+#include <gtest/gtest.h>
+#include "common/gauss.hpp"
+#include "utest/test_images.hpp"
+#include <atomic>
+#include <omp.h>
+#include <vector>
+
+namespace {
+
+  using images::test::random_image;
+
+  // Straightforward 5x5 convolution over a copy of the image
+  std::vector<uint8_t> reference_gauss(const std::vector<uint8_t> & data, int rows, int row_length,
+      int step) {
+    constexpr std::array<int, 25> kernel{1, 4, 7, 4, 1, 4, 16, 26, 16, 4, 7, 26, 41, 26, 7, 4, 16,
+                                         26, 16, 4, 1, 4, 7, 4, 1};
+    std::vector<uint8_t> result(data.size());
+    for (int r = 0; r < rows; ++r) {
+      for (int j = 0; j < row_length; ++j) {
+        long accum = 0;
+        for (int k = 0; k < 25; ++k) {
+          const int i = r + k / 5 - 2;
+          const int c = j + (k % 5 - 2) * step;
+          if (i < 0 || i >= rows || c < 0 || c >= row_length) { continue; }
+          accum += kernel[k] * data[i * row_length + c];
+        }
+        result[r * row_length + j] = static_cast<uint8_t>(accum / 273);
+      }
+    }
+    return result;
+  }
+
+}
+
+TEST(gauss, matches_reference) {
+  const int default_threads = omp_get_max_threads();
+  for (int threads: {1, 2, 3, 7}) {
+    omp_set_num_threads(threads);
+    for (int step: {1, 3}) {
+      for (auto [rows, columns]: {std::pair{1, 1}, {2, 3}, {5, 5}, {9, 4}, {17, 33}, {40, 7}}) {
+        const int row_length = columns * step;
+        auto data = random_image(rows * row_length);
+        const auto expected = reference_gauss(data, rows, row_length, step);
+        images::common::gauss_blur(data, rows, row_length, step);
+        EXPECT_EQ(expected, data) << threads << " threads, step " << step << ", " << rows << "x"
+                                  << columns;
+      }
+    }
+  }
+  omp_set_num_threads(default_threads);
+}
+
+
+namespace {
+
+  // Largest per byte difference between the exact and the approximate blur of an image
+  int approximate_error(const std::vector<uint8_t> & data, int rows, int row_length, int step) {
+    auto exact = data;
+    auto approximate = data;
+    images::common::gauss_blur(exact, rows, row_length, step);
+    images::common::gauss_blur(approximate, rows, row_length, step,
+        images::common::gauss_mode::approximate);
+    int error = 0;
+    for (std::size_t i = 0; i < data.size(); ++i) {
+      error = std::max(error, std::abs(exact[i] - approximate[i]));
+    }
+    return error;
+  }
+
+}
+
+TEST(gauss, vector_kernels_match_reference) {
+  using images::common::gauss_mode;
+  for (auto level: images::common::supported_simd_levels()) {
+    for (int step: {1, 3}) {
+      for (auto [rows, columns]: {std::pair{3, 8}, {6, 37}, {9, 70}, {33, 129}}) {
+        const int row_length = columns * step;
+        auto data = random_image(rows * row_length);
+        const auto expected = reference_gauss(data, rows, row_length, step);
+        auto approximate = data;
+        images::common::gauss_blur(approximate, rows, row_length, step, gauss_mode::approximate,
+            images::common::simd_level::scalar);
+        images::common::gauss_blur(data, rows, row_length, step, gauss_mode::exact, level);
+        EXPECT_EQ(expected, data) << static_cast<int>(level) << ", step " << step << ", " << rows
+                                  << "x" << columns;
+        auto vector_approximate = random_image(rows * row_length);
+        images::common::gauss_blur(vector_approximate, rows, row_length, step,
+            gauss_mode::approximate, level);
+        EXPECT_EQ(approximate, vector_approximate) << static_cast<int>(level) << ", step " << step;
+      }
+    }
+  }
+}
+
+TEST(gauss, vector_kernels_saturated_image) {
+  // The largest sums the vector division has to handle
+  for (auto level: images::common::supported_simd_levels()) {
+    for (int step: {1, 3}) {
+      const int row_length = 70 * step;
+      std::vector<uint8_t> data(40L * row_length, 255);
+      images::common::gauss_blur(data, 40, row_length, step, images::common::gauss_mode::exact,
+          level);
+      const auto expected = reference_gauss(std::vector<uint8_t>(40L * row_length, 255), 40,
+          row_length, step);
+      EXPECT_EQ(expected, data) << static_cast<int>(level) << ", step " << step;
+    }
+  }
+}
+
+TEST(gauss, approximate_within_bound_random) {
+  for (int step: {1, 3}) {
+    for (auto [rows, columns]: {std::pair{1, 1}, {5, 5}, {17, 33}, {64, 64}}) {
+      const int row_length = columns * step;
+      const auto data = random_image(rows * row_length);
+      EXPECT_LE(approximate_error(data, rows, row_length, step),
+          images::common::approximate_gauss_max_error);
+    }
+  }
+}
+
+TEST(gauss, approximate_within_bound_adversarial) {
+  // Bright where the approximate kernel weighs more than the exact one, dark elsewhere
+  constexpr int size = 15;
+  std::vector<uint8_t> data(size * size);
+  for (int r = 0; r < size; ++r) {
+    for (int c = 0; c < size; ++c) {
+      const bool corner = (r % 5 == 1 || r % 5 == 3) == (c % 5 == 1 || c % 5 == 3);
+      data[r * size + c] = corner ? 255 : 0;
+    }
+  }
+  const int error = approximate_error(data, size, size, 1);
+  EXPECT_LE(error, images::common::approximate_gauss_max_error);
+  EXPECT_GT(error, 0);
+}
+
+TEST(gauss, tiled_matches_reference) {
+  using images::common::gauss_mode;
+  using images::common::gauss_tile;
+  const int default_threads = omp_get_max_threads();
+  for (int threads: {1, 3}) {
+    omp_set_num_threads(threads);
+    for (int step: {1, 3}) {
+      for (auto tile: {gauss_tile{1, 1}, gauss_tile{3, 7}, gauss_tile{5, 16}, gauss_tile{64, 40}}) {
+        for (auto [rows, columns]: {std::pair{1, 1}, {5, 5}, {17, 33}, {40, 70}}) {
+          const int row_length = columns * step;
+          auto data = random_image(rows * row_length);
+          const auto expected = reference_gauss(data, rows, row_length, step);
+          auto approximate = data;
+          images::common::gauss_blur(approximate, rows, row_length, step,
+              gauss_mode::approximate);
+          auto tiled_approximate = data;
+          images::common::gauss_blur_tiled(data, rows, row_length, step, tile);
+          EXPECT_EQ(expected, data) << threads << " threads, step " << step << ", tile "
+                                    << tile.rows << "x" << tile.columns << ", " << rows << "x"
+                                    << columns;
+          images::common::gauss_blur_tiled(tiled_approximate, rows, row_length, step, tile,
+              gauss_mode::approximate);
+          EXPECT_EQ(approximate, tiled_approximate) << threads << " threads, step " << step;
+        }
+      }
+    }
+  }
+  omp_set_num_threads(default_threads);
+}
+
+TEST(gauss, reports_each_row_once) {
+  using images::common::gauss_mode;
+  constexpr int rows = 37;
+  constexpr int row_length = 50;
+  for (bool tiled: {false, true}) {
+    std::vector<std::atomic<int>> finished(rows);
+    const images::common::finished_row on_row = [&](int r) { ++finished[r]; };
+    auto data = random_image(rows * row_length);
+    if (tiled) {
+      images::common::gauss_blur_tiled(data, rows, row_length, 1, {8, 16}, gauss_mode::exact,
+          images::common::detected_simd_level(), on_row);
+    }
+    else {
+      images::common::gauss_blur(data, rows, row_length, 1, gauss_mode::exact,
+          images::common::detected_simd_level(), on_row);
+    }
+    for (int r = 0; r < rows; ++r) { EXPECT_EQ(1, finished[r]) << tiled << ", row " << r; }
+  }
+}
+
+TEST(gauss, iterated_matches_repeated) {
+  using images::common::gauss_mode;
+  const int default_threads = omp_get_max_threads();
+  for (int threads: {1, 2, 3, 7}) {
+    omp_set_num_threads(threads);
+    for (auto mode: {gauss_mode::exact, gauss_mode::approximate}) {
+      for (int step: {1, 3}) {
+        for (int iterations: {2, 3, 5}) {
+          for (auto [rows, columns]: {std::pair{1, 1}, {4, 3}, {9, 4}, {40, 33}}) {
+            const int row_length = columns * step;
+            auto data = random_image(rows * row_length);
+            auto expected = data;
+            for (int i = 0; i < iterations; ++i) {
+              images::common::gauss_blur(expected, rows, row_length, step, mode);
+            }
+            std::vector<std::atomic<int>> finished(static_cast<std::size_t>(rows));
+            images::common::gauss_blur_iterated(data, rows, row_length, step, iterations, mode,
+                images::common::detected_simd_level(), [&](int r) { ++finished[r]; });
+            EXPECT_EQ(expected, data) << threads << " threads, step " << step << ", "
+                                      << iterations << " iterations, " << rows << "x" << columns;
+            for (int r = 0; r < rows; ++r) { EXPECT_EQ(1, finished[r]) << "row " << r; }
+          }
+        }
+      }
+    }
+  }
+  omp_set_num_threads(default_threads);
+}
+
+TEST(gauss, iterated_tiled_matches_repeated) {
+  using images::common::gauss_mode;
+  using images::common::gauss_tile;
+  const int default_threads = omp_get_max_threads();
+  for (int threads: {1, 3}) {
+    omp_set_num_threads(threads);
+    for (auto mode: {gauss_mode::exact, gauss_mode::approximate}) {
+      for (int step: {1, 3}) {
+        for (int iterations: {1, 2, 4}) {
+          for (auto tile: {gauss_tile{1, 1}, gauss_tile{8, 16}, gauss_tile{64, 40}}) {
+            for (auto [rows, columns]: {std::pair{1, 1}, {9, 4}, {40, 70}}) {
+              const int row_length = columns * step;
+              auto data = random_image(rows * row_length);
+              auto expected = data;
+              for (int i = 0; i < iterations; ++i) {
+                images::common::gauss_blur(expected, rows, row_length, step, mode);
+              }
+              std::vector<std::atomic<int>> finished(static_cast<std::size_t>(rows));
+              images::common::gauss_blur_iterated_tiled(data, rows, row_length, step, iterations,
+                  tile, mode, images::common::detected_simd_level(),
+                  [&](int r) { ++finished[r]; });
+              EXPECT_EQ(expected, data) << threads << " threads, step " << step << ", "
+                                        << iterations << " iterations, tile " << tile.rows
+                                        << "x" << tile.columns << ", " << rows << "x" << columns;
+              for (int r = 0; r < rows; ++r) { EXPECT_EQ(1, finished[r]) << "row " << r; }
+            }
+          }
+        }
+      }
+    }
+  }
+  omp_set_num_threads(default_threads);
+}
+
+TEST(gauss, planes_match_iterated) {
+  using images::common::gauss_mode;
+  using images::common::gauss_tile;
+  const int default_threads = omp_get_max_threads();
+  for (int threads: {1, 3}) {
+    omp_set_num_threads(threads);
+    for (int iterations: {1, 3}) {
+      for (auto tile: {gauss_tile{1, 1}, gauss_tile{8, 16}, gauss_tile{64, 40}}) {
+        for (auto [rows, columns]: {std::pair{1, 1}, {9, 4}, {40, 70}}) {
+          const auto size = static_cast<std::size_t>(rows) * static_cast<std::size_t>(columns);
+          const auto noise = random_image(static_cast<int>(3 * size));
+          std::array<std::vector<uint8_t>, 3> data;
+          std::array<std::vector<uint8_t>, 3> expected;
+          for (std::size_t p = 0; p < data.size(); ++p) {
+            data[p].assign(noise.begin() + static_cast<long>(p * size),
+                noise.begin() + static_cast<long>((p + 1) * size));
+            expected[p] = data[p];
+            images::common::gauss_blur_iterated(expected[p], rows, columns, 1, iterations);
+          }
+          const std::array<std::span<uint8_t>, 3> planes{data[0], data[1], data[2]};
+          // Each row is reported once, and only when it is final in every plane
+          std::vector<std::atomic<int>> finished(static_cast<std::size_t>(rows));
+          std::vector<std::atomic<bool>> final_when_reported(static_cast<std::size_t>(rows));
+          images::common::gauss_blur_planes_tiled(planes, rows, columns, iterations, tile,
+              gauss_mode::exact, images::common::detected_simd_level(), [&](int r) {
+                ++finished[r];
+                bool final = true;
+                for (std::size_t p = 0; p < data.size(); ++p) {
+                  const auto row = std::span{data[p]}.subspan(r * columns, columns);
+                  final = final and std::ranges::equal(row,
+                      std::span{expected[p]}.subspan(r * columns, columns));
+                }
+                final_when_reported[r] = final;
+              });
+          EXPECT_EQ(expected, data) << threads << " threads, " << iterations << " iterations, tile "
+                                    << tile.rows << "x" << tile.columns << ", " << rows << "x"
+                                    << columns;
+          for (int r = 0; r < rows; ++r) {
+            EXPECT_EQ(1, finished[r]) << "row " << r;
+            EXPECT_TRUE(final_when_reported[r]) << "row " << r;
+          }
+        }
+      }
+    }
+  }
+  omp_set_num_threads(default_threads);
+}
@@ -0,0 +1,52 @@
+#include <gtest/gtest.h>
+#include "common/gray.hpp"
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+  using namespace images::common;
+}
+
+TEST(gray, planes_match_pixels) {
+  for (auto level: supported_simd_levels()) {
+    for (int count: {0, 1, 7, 8, 9, 16, 17, 100}) {
+      std::array<std::vector<uint8_t>, num_channels> planes;
+      for (int ch = 0; ch < num_channels; ++ch) {
+        for (int p = 0; p < count; ++p) {
+          planes[ch].push_back(static_cast<uint8_t>(p * (ch + 5) * 13 + ch * 71));
+        }
+      }
+      std::vector<uint8_t> expected;
+      for (int p = 0; p < count; ++p) {
+        expected.push_back(to_gray_corrected(planes[red_channel][p], planes[green_channel][p],
+            planes[blue_channel][p]));
+      }
+      std::vector<uint8_t> out(static_cast<std::size_t>(count));
+      planes_to_gray({planes[0].data(), planes[1].data(), planes[2].data()}, out.data(),
+          static_cast<std::size_t>(count), level);
+      EXPECT_EQ(expected, out) << static_cast<int>(level) << ", " << count << " pixels";
+      // In place over the blue plane
+      planes_to_gray({planes[0].data(), planes[1].data(), planes[2].data()}, planes[0].data(),
+          static_cast<std::size_t>(count), level);
+      EXPECT_EQ(expected, planes[0]) << static_cast<int>(level) << ", " << count << " pixels";
+    }
+  }
+}
+
+TEST(gray, print_mismatch) {
+  std::ostringstream out;
+  out << gray_mismatch{1, 20, 255, 7, 8};
+  EXPECT_EQ("(1,20,255): expected 7, got 8", out.str());
+}
+
+TEST(gray, exhaustive_verification) {
+  std::ostringstream out;
+  EXPECT_TRUE(verify_gray_kernels(out));
+  std::string expected;
+  for (auto level: supported_simd_levels()) {
+    expected += "Gray kernel at " + std::string{to_string(level)} + ": 0 mismatches\n";
+  }
+  // Only the first mismatches are worth showing
+  EXPECT_EQ(expected, out.str().substr(0, 2048));
+}
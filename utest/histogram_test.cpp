@@ -31,3 +31,97 @@ TEST(histogram, add_color) {
   }
   EXPECT_TRUE(in);
 }
+
+namespace {
+
+  // Packed BGR bytes of count pixels with channels i % 7, i % 11 and i / 13, runs of one value
+  // included
+  std::vector<uint8_t> sample_bgr(std::size_t count) {
+    std::vector<uint8_t> bgr(count * 3);
+    for (std::size_t i = 0; i < count; ++i) {
+      bgr[i * 3] = static_cast<uint8_t>(i % 7);
+      bgr[i * 3 + 1] = static_cast<uint8_t>(i % 11);
+      bgr[i * 3 + 2] = static_cast<uint8_t>(i / 13);
+    }
+    return bgr;
+  }
+
+  images::common::histogram expected_bgr(const std::vector<uint8_t> & bgr) {
+    images::common::histogram h;
+    for (std::size_t i = 0; i < bgr.size(); i += 3) {
+      h.add_color({bgr[i + 2], bgr[i + 1], bgr[i]});
+    }
+    return h;
+  }
+
+  void expect_equal(const images::common::histogram & expected,
+      const images::common::histogram & actual) {
+    for (int v = 0; v < images::common::histogram::num_levels; ++v) {
+      const auto level = static_cast<uint8_t>(v);
+      EXPECT_EQ(expected.get_red_frequency(level), actual.get_red_frequency(level)) << v;
+      EXPECT_EQ(expected.get_green_frequency(level), actual.get_green_frequency(level)) << v;
+      EXPECT_EQ(expected.get_blue_frequency(level), actual.get_blue_frequency(level)) << v;
+    }
+  }
+
+}
+
+TEST(histogram_counters, count_bgr) {
+  using namespace images::common;
+  const auto bgr = sample_bgr(1000);
+  const std::span all{bgr};
+  // Splits of every length up to the banks of a thread, over several threads
+  histogram_counters counters{3};
+  std::size_t first = 0;
+  for (std::size_t n = 0; first < bgr.size() / 3; ++n) {
+    const std::size_t count = std::min(n % 6, bgr.size() / 3 - first);
+    counters.count_bgr(static_cast<int>(n % 3), all.subspan(first * 3, count * 3));
+    first += count;
+  }
+  expect_equal(expected_bgr(bgr), counters.merge());
+}
+
+TEST(histogram_counters, count_planes) {
+  using namespace images::common;
+  const auto bgr = sample_bgr(1001);
+  std::array<std::vector<uint8_t>, 3> planes;
+  for (std::size_t c = 0; c < 3; ++c) {
+    for (std::size_t i = c; i < bgr.size(); i += 3) { planes[c].push_back(bgr[i]); }
+  }
+  histogram_counters counters{2};
+  counters.count_planes(0, {planes[0].data(), planes[1].data(), planes[2].data()}, 500);
+  counters.count_planes(1, {planes[0].data() + 500, planes[1].data() + 500,
+                            planes[2].data() + 500}, 501);
+  expect_equal(expected_bgr(bgr), counters.merge());
+}
+
+TEST(histogram_counters, count_gray) {
+  using namespace images::common;
+  const auto bgr = sample_bgr(999);
+  level_map map{};
+  for (std::size_t v = 0; v < map.size(); ++v) { map[v] = static_cast<uint8_t>(255 - v); }
+  histogram expected;
+  histogram_counters counters{2};
+  // Red bytes of the packed pixels, then the blue ones as a plane of their own through map
+  std::vector<uint8_t> blue;
+  for (std::size_t i = 0; i < bgr.size(); i += 3) {
+    expected.add_color({bgr[i + 2], bgr[i + 2], bgr[i + 2]});
+    expected.add_color({map[bgr[i]], map[bgr[i]], map[bgr[i]]});
+    blue.push_back(bgr[i]);
+  }
+  counters.count_gray(0, std::span{bgr}.subspan(2), 3);
+  counters.count_gray(1, blue, map);
+  expect_equal(expected, counters.merge());
+}
+
+TEST(histogram_counters, gray_and_colour) {
+  using namespace images::common;
+  const auto bgr = sample_bgr(100);
+  const std::vector<uint8_t> gray(50, 9);
+  histogram expected = expected_bgr(bgr);
+  for (const auto level : gray) { expected.add_color({level, level, level}); }
+  histogram_counters counters{1};
+  counters.count_bgr(0, bgr);
+  counters.count_gray(0, gray);
+  expect_equal(expected, counters.merge());
+}
@@ -1,5 +1,6 @@
 #include <gtest/gtest.h>
 #include "common/pixel.hpp"
+#include "common/normalized_pixel.hpp"
 
 TEST(pixel, default_construct) {
   using namespace images::common;
@@ -98,3 +99,24 @@ TEST(pixel, read) {
   EXPECT_EQ(20, p.green());
   EXPECT_EQ(30, p.blue());
 }
+
+TEST(pixel, gray_table_matches_formula) {
+  using namespace images::common;
+  const auto & gray = gray_levels();
+  long mismatches = 0;
+#pragma omp parallel for reduction(+ : mismatches) default(none) shared(gray)
+  for (int r = 0; r < 256; ++r) {
+    for (int g = 0; g < 256; ++g) {
+      for (int b = 0; b < 256; ++b) {
+        const auto red = static_cast<uint8_t>(r);
+        const auto green = static_cast<uint8_t>(g);
+        const auto blue = static_cast<uint8_t>(b);
+        normalized_pixel linear{red, green, blue};
+        linear.intensity_transform();
+        const auto expected = gray_denormalize(gamma_correction(linear.to_gray()));
+        if (gray(red, green, blue) != expected) { ++mismatches; }
+      }
+    }
+  }
+  EXPECT_EQ(0, mismatches);
+}
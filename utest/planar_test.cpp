@@ -0,0 +1,86 @@
+#include <gtest/gtest.h>
+#include "common/planar.hpp"
+#include <vector>
+
+namespace {
+
+  using namespace images::common;
+
+  std::vector<uint8_t> make_bgr(int count) {
+    std::vector<uint8_t> bgr(static_cast<std::size_t>(count) * num_channels);
+    for (std::size_t i = 0; i < bgr.size(); ++i) {
+      bgr[i] = static_cast<uint8_t>(i * 7 + i / 3);
+    }
+    return bgr;
+  }
+
+}
+
+TEST(planar, deinterleave) {
+  for (auto level: supported_simd_levels()) {
+    for (int count: {0, 1, 15, 16, 17, 31, 32, 33, 100}) {
+      const auto bgr = make_bgr(count);
+      std::array<std::vector<uint8_t>, num_channels> planes;
+      for (auto & p: planes) { p.resize(count); }
+      deinterleave_bgr(bgr, {planes[0].data(), planes[1].data(), planes[2].data()}, level);
+      for (int p = 0; p < count; ++p) {
+        ASSERT_EQ(bgr[p * 3 + blue_channel], planes[blue_channel][p]);
+        ASSERT_EQ(bgr[p * 3 + green_channel], planes[green_channel][p]);
+        ASSERT_EQ(bgr[p * 3 + red_channel], planes[red_channel][p]);
+      }
+    }
+  }
+}
+
+TEST(planar, interleave) {
+  for (auto level: supported_simd_levels()) {
+    for (int count: {0, 1, 15, 16, 17, 31, 32, 33, 100}) {
+      const auto expected = make_bgr(count);
+      std::array<std::vector<uint8_t>, num_channels> planes;
+      for (auto & p: planes) { p.resize(count); }
+      deinterleave_bgr(expected, {planes[0].data(), planes[1].data(), planes[2].data()},
+          simd_level::scalar);
+      std::vector<uint8_t> bgr(expected.size());
+      interleave_bgr({planes[0].data(), planes[1].data(), planes[2].data()}, bgr, level);
+      ASSERT_EQ(expected, bgr);
+    }
+  }
+}
+
+TEST(planar, is_gray_bgr) {
+  for (auto level: supported_simd_levels()) {
+    for (int count: {0, 1, 15, 16, 17, 31, 32, 33, 100}) {
+      std::vector<uint8_t> bgr(static_cast<std::size_t>(count) * num_channels);
+      for (std::size_t i = 0; i < bgr.size(); ++i) { bgr[i] = static_cast<uint8_t>(i / 3 * 11); }
+      EXPECT_TRUE(is_gray_bgr(bgr, level)) << count;
+      // One channel of one pixel off, anywhere
+      for (std::size_t i = 0; i < bgr.size(); ++i) {
+        auto colour = bgr;
+        ++colour[i];
+        EXPECT_FALSE(is_gray_bgr(colour, level)) << count << " pixels, byte " << i;
+      }
+    }
+  }
+}
+
+TEST(planar, planes_equal) {
+  for (auto level: supported_simd_levels()) {
+    for (int count: {0, 1, 15, 16, 17, 31, 32, 33, 100}) {
+      std::array<std::vector<uint8_t>, num_channels> planes;
+      for (auto & p: planes) {
+        for (int i = 0; i < count; ++i) { p.push_back(static_cast<uint8_t>(i * 5)); }
+      }
+      const auto size = static_cast<std::size_t>(count);
+      EXPECT_TRUE(planes_equal({planes[0].data(), planes[1].data(), planes[2].data()}, size,
+          level)) << count;
+      for (int ch = 0; ch < num_channels; ++ch) {
+        for (int i = 0; i < count; ++i) {
+          auto colour = planes;
+          ++colour[ch][i];
+          EXPECT_FALSE(planes_equal({colour[0].data(), colour[1].data(), colour[2].data()}, size,
+              level)) << count << " pixels, channel " << ch << ", pixel " << i;
+        }
+      }
+    }
+  }
+}
@@ -25,6 +25,13 @@ TEST(progargs, to_subcommand_histo) {
   EXPECT_EQ(subcommand::histo, subcmd);
 }
 
+TEST(progargs, to_subcommand_filters) {
+  using namespace images::common;
+  EXPECT_EQ(subcommand::box, to_subcommand("box"));
+  EXPECT_EQ(subcommand::sharpen, to_subcommand("sharpen"));
+  EXPECT_EQ(subcommand::emboss, to_subcommand("emboss"));
+}
+
 TEST(progargs, to_subcommand_info) {
   using namespace images::common;
   auto subcmd = to_subcommand("info");
@@ -76,4 +83,158 @@ TEST(progargs, correct_config) {
   EXPECT_EQ("in", conf.input_dir);
   EXPECT_EQ("out", conf.output_dir);
   EXPECT_EQ(images::common::subcommand::copy, conf.subcmd);
-}
\ No newline at end of file
+}
+
+TEST(progargs, approximate_gauss_option) {
+  std::filesystem::create_directory("in");
+  std::filesystem::create_directory("out");
+  std::vector<std::string> args{"img", "in", "out", "gauss", "--approx-gauss"};
+  auto conf = images::common::parse_arguments(args);
+  EXPECT_EQ(images::common::subcommand::gauss, conf.subcmd);
+  EXPECT_TRUE(conf.opts.approximate_gauss);
+}
+
+TEST(progargs, default_options) {
+  std::filesystem::create_directory("in");
+  std::filesystem::create_directory("out");
+  std::vector<std::string> args{"img", "in", "out", "gauss"};
+  auto conf = images::common::parse_arguments(args);
+  EXPECT_FALSE(conf.opts.approximate_gauss);
+}
+
+TEST(progargs, unknown_option) {
+  std::filesystem::create_directory("in");
+  std::filesystem::create_directory("out");
+  std::vector<std::string> args{"img", "in", "out", "gauss", "--unknown"};
+  EXPECT_DEATH({
+    auto conf = images::common::parse_arguments(args);
+  }, "");
+}
+
+TEST(progargs, operation_chain) {
+  std::filesystem::create_directory("in");
+  std::filesystem::create_directory("out");
+  std::vector<std::string> args{"img", "in", "out", "gauss,mono,histo"};
+  auto conf = images::common::parse_arguments(args);
+  using images::common::subcommand;
+  EXPECT_EQ(subcommand::histo, conf.subcmd);
+  EXPECT_EQ((std::vector{subcommand::gauss, subcommand::mono}), conf.steps);
+}
+
+TEST(progargs, histo_inside_chain) {
+  std::filesystem::create_directory("in");
+  std::filesystem::create_directory("out");
+  std::vector<std::string> args{"img", "in", "out", "histo,mono"};
+  EXPECT_DEATH({
+    auto conf = images::common::parse_arguments(args);
+  }, "");
+}
+
+TEST(progargs, empty_operation_in_chain) {
+  std::filesystem::create_directory("in");
+  std::filesystem::create_directory("out");
+  std::vector<std::string> args{"img", "in", "out", "gauss,"};
+  EXPECT_DEATH({
+    auto conf = images::common::parse_arguments(args);
+  }, "");
+}
+
+TEST(progargs, repeated_gauss) {
+  std::filesystem::create_directory("in");
+  std::filesystem::create_directory("out");
+  std::vector<std::string> args{"img", "in", "out", "gauss:3,mono"};
+  auto conf = images::common::parse_arguments(args);
+  using images::common::subcommand;
+  EXPECT_EQ(subcommand::mono, conf.subcmd);
+  EXPECT_EQ((std::vector(3, subcommand::gauss)), conf.steps);
+}
+
+TEST(progargs, invalid_repeat) {
+  std::filesystem::create_directory("in");
+  std::filesystem::create_directory("out");
+  for (const auto * chain: {"gauss:0", "gauss:2x", "mono:2"}) {
+    std::vector<std::string> args{"img", "in", "out", chain};
+    EXPECT_DEATH({
+      auto conf = images::common::parse_arguments(args);
+    }, "") << chain;
+  }
+}
+
+TEST(progargs, blur_sigma) {
+  std::filesystem::create_directory("in");
+  std::filesystem::create_directory("out");
+  std::vector<std::string> args{"img", "in", "out", "blur:2.5"};
+  auto conf = images::common::parse_arguments(args);
+  EXPECT_EQ(images::common::subcommand::blur, conf.subcmd);
+  EXPECT_EQ(2.5, conf.opts.blur_sigma);
+  args.back() = "blur";
+  conf = images::common::parse_arguments(args);
+  EXPECT_EQ(images::common::default_blur_sigma, conf.opts.blur_sigma);
+}
+
+TEST(progargs, invalid_blur_sigma) {
+  std::filesystem::create_directory("in");
+  std::filesystem::create_directory("out");
+  for (const auto * chain: {"blur:0", "blur:-1", "blur:x", "blur:2,blur:3"}) {
+    std::vector<std::string> args{"img", "in", "out", chain};
+    EXPECT_DEATH({
+      auto conf = images::common::parse_arguments(args);
+    }, "") << chain;
+  }
+}
+
+TEST(progargs, schedule_option) {
+  std::filesystem::create_directory("in");
+  std::filesystem::create_directory("out");
+  std::vector<std::string> args{"img", "in", "out", "mono", "--schedule=guided:4"};
+  auto conf = images::common::parse_arguments(args);
+  EXPECT_EQ((images::common::loop_schedule{omp_sched_guided, 4}), conf.opts.schedule);
+  EXPECT_FALSE(conf.opts.autotune);
+  args.back() = "--autotune";
+  conf = images::common::parse_arguments(args);
+  EXPECT_EQ(std::nullopt, conf.opts.schedule);
+  EXPECT_TRUE(conf.opts.autotune);
+  EXPECT_EQ("img.schedule", conf.schedule_file);
+}
+
+TEST(progargs, gray_palette_option) {
+  std::filesystem::create_directory("in");
+  std::filesystem::create_directory("out");
+  std::vector<std::string> args{"img", "in", "out", "mono"};
+  EXPECT_FALSE(images::common::parse_arguments(args).opts.gray_palette);
+  args.emplace_back("--gray-palette");
+  EXPECT_TRUE(images::common::parse_arguments(args).opts.gray_palette);
+}
+
+TEST(progargs, invalid_schedule_option) {
+  std::filesystem::create_directory("in");
+  std::filesystem::create_directory("out");
+  for (const auto * option: {"--schedule=", "--schedule=auto", "--schedule=dynamic:0"}) {
+    std::vector<std::string> args{"img", "in", "out", "mono", option};
+    EXPECT_DEATH({
+      auto conf = images::common::parse_arguments(args);
+    }, "") << option;
+  }
+  std::vector<std::string> args{"img", "in", "out", "mono", "--schedule=static", "--autotune"};
+  EXPECT_DEATH({
+    auto conf = images::common::parse_arguments(args);
+  }, "");
+}
+
+TEST(progargs, verify_gray) {
+  using namespace images::common;
+  EXPECT_EQ(subcommand::verify_gray, to_subcommand("verify-gray"));
+  std::vector<std::string> args{"img", "verify-gray"};
+  EXPECT_EQ(subcommand::verify_gray, parse_arguments(args).subcmd);
+}
+
+TEST(progargs, verify_gray_with_paths) {
+  std::filesystem::create_directory("in");
+  std::filesystem::create_directory("out");
+  for (const auto * operation: {"verify-gray", "mono,verify-gray"}) {
+    std::vector<std::string> args{"img", "in", "out", operation};
+    EXPECT_DEATH({
+      auto conf = images::common::parse_arguments(args);
+    }, "") << operation;
+  }
+}
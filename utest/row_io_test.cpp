@@ -0,0 +1,89 @@
+#include <gtest/gtest.h>
+#include "common/row_io.hpp"
+#include "common/file_error.hpp"
+
+namespace {
+
+  // Builds an in-memory bitmap whose pixel bytes are numbered row by row
+  std::string make_bitmap(int width, int height, bool with_padding = true) {
+    using images::common::bitmap_header;
+    std::ostringstream out;
+    const bitmap_header header{width, height};
+    header.write(out);
+    std::string data = out.str();
+    data[0] = 'B';
+    data[1] = 'M';
+    for (int r = 0; r < height; ++r) {
+      for (int c = 0; c < header.row_bytes(); ++c) {
+        data.push_back(static_cast<char>(r * 16 + c));
+      }
+      if (with_padding or r + 1 < height) {
+        data.append(static_cast<std::size_t>(header.row_padding()), '\0');
+      }
+    }
+    return data;
+  }
+
+}
+
+TEST(row_reader, read_rows) {
+  using namespace images::common;
+  std::istringstream in{make_bitmap(3, 5)};
+  bitmap_header header;
+  header.read(in);
+  row_reader reader{in, header};
+  int rows_read = 0;
+  for (int rows = reader.next_band(); rows > 0; rows = reader.next_band()) {
+    for (int i = 0; i < rows; ++i) {
+      const int r = reader.band_start() + i;
+      const auto row = reader.row(i);
+      ASSERT_EQ(9, std::ssize(row));
+      for (int c = 0; c < 9; ++c) {
+        EXPECT_EQ(static_cast<uint8_t>(r * 16 + c), row[c]);
+      }
+      ++rows_read;
+    }
+  }
+  EXPECT_EQ(5, rows_read);
+}
+
+TEST(row_reader, missing_last_padding) {
+  using namespace images::common;
+  std::istringstream in{make_bitmap(1, 2, false)};
+  bitmap_header header;
+  header.read(in);
+  row_reader reader{in, header};
+  EXPECT_EQ(2, reader.next_band());
+  EXPECT_EQ(0, reader.next_band());
+}
+
+TEST(row_reader, truncated) {
+  using namespace images::common;
+  auto data = make_bitmap(3, 5);
+  data.resize(data.size() - 13);
+  std::istringstream in{data};
+  bitmap_header header;
+  header.read(in);
+  row_reader reader{in, header};
+  EXPECT_THROW(reader.next_band(), file_error);
+}
+
+TEST(row_writer, write_rows) {
+  using namespace images::common;
+  const auto data = make_bitmap(3, 5);
+  std::istringstream in{data};
+  bitmap_header header;
+  header.read(in);
+  std::ostringstream out;
+  header.write(out);
+  row_writer writer{out, header};
+  for (int r = 0; r < header.height(); ++r) {
+    const auto row = writer.next_row();
+    ASSERT_EQ(9, std::ssize(row));
+    for (int c = 0; c < 9; ++c) {
+      row[c] = static_cast<uint8_t>(r * 16 + c);
+    }
+  }
+  writer.flush();
+  EXPECT_EQ(data, out.str());
+}
@@ -0,0 +1,75 @@
+#include <gtest/gtest.h>
+#include "common/schedule.hpp"
+#include <fstream>
+
+TEST(schedule, parse) {
+  using images::common::loop_schedule;
+  using images::common::to_loop_schedule;
+  EXPECT_EQ((loop_schedule{omp_sched_static, 0}), to_loop_schedule("static"));
+  EXPECT_EQ((loop_schedule{omp_sched_dynamic, 16}), to_loop_schedule("dynamic:16"));
+  EXPECT_EQ((loop_schedule{omp_sched_guided, 2}), to_loop_schedule("guided:2"));
+  for (const auto * text: {"", "auto", "dynamic:", "dynamic:0", "guided:-1", "static:4x"}) {
+    EXPECT_EQ(std::nullopt, to_loop_schedule(text)) << text;
+  }
+}
+
+TEST(schedule, to_string_round_trip) {
+  for (const auto candidate: images::common::schedule_candidates) {
+    EXPECT_EQ(candidate, images::common::to_loop_schedule(images::common::to_string(candidate)));
+  }
+}
+
+TEST(schedule, scoped_schedule_restores) {
+  omp_set_schedule(omp_sched_static, 3);
+  {
+    const images::common::scoped_schedule schedule{{omp_sched_guided, 5}};
+    omp_sched_t kind{};
+    int chunk = 0;
+    omp_get_schedule(&kind, &chunk);
+    EXPECT_EQ(omp_sched_guided, kind);
+    EXPECT_EQ(5, chunk);
+  }
+  omp_sched_t kind{};
+  int chunk = 0;
+  omp_get_schedule(&kind, &chunk);
+  EXPECT_EQ(omp_sched_static, kind);
+  EXPECT_EQ(3, chunk);
+}
+
+TEST(schedule, size_class) {
+  using images::common::size_class;
+  EXPECT_EQ(size_class(1980L * 1320), size_class(2000L * 1300));
+  EXPECT_LT(size_class(1980L * 1320), size_class(4 * 1980L * 1320));
+  EXPECT_EQ(0, size_class(0));
+}
+
+TEST(schedule, profile_round_trip) {
+  const std::filesystem::path file = "schedule_test.schedule";
+  std::filesystem::remove(file);
+  {
+    images::common::schedule_profile profile{file};
+    EXPECT_EQ(std::nullopt, profile.find("gauss,mono", 11, 8));
+    profile.store("gauss,mono", 11, 8, {omp_sched_dynamic, 16});
+    profile.store("histo", 9, 8, {omp_sched_static, 0});
+  }
+  const images::common::schedule_profile profile{file};
+  EXPECT_EQ((images::common::loop_schedule{omp_sched_dynamic, 16}),
+      profile.find("gauss,mono", 11, 8));
+  EXPECT_EQ((images::common::loop_schedule{omp_sched_static, 0}), profile.find("histo", 9, 8));
+  EXPECT_EQ(std::nullopt, profile.find("histo", 11, 8));
+  EXPECT_EQ(std::nullopt, profile.find("histo", 9, 4));
+  std::filesystem::remove(file);
+}
+
+TEST(schedule, profile_skips_bad_lines) {
+  const std::filesystem::path file = "schedule_bad.schedule";
+  {
+    std::ofstream out{file};
+    out << "mono 10 4 sometimes 4\nmono\nmono 11 guided 1\nmono 12 4 guided 1\n";
+  }
+  const images::common::schedule_profile profile{file};
+  EXPECT_EQ(std::nullopt, profile.find("mono", 10, 4));
+  EXPECT_EQ(std::nullopt, profile.find("mono", 11, 4));
+  EXPECT_EQ((images::common::loop_schedule{omp_sched_guided, 1}), profile.find("mono", 12, 4));
+  std::filesystem::remove(file);
+}
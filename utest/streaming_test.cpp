@@ -0,0 +1,67 @@
+#include <gtest/gtest.h>
+#include "common/streaming.hpp"
+#include "common/file_error.hpp"
+#include "aos/bitmap_aos.hpp"
+#include <fstream>
+#include <iterator>
+
+namespace {
+
+  std::string file_contents(const std::filesystem::path & name) {
+    std::ifstream in{name};
+    return {std::istreambuf_iterator<char>{in}, std::istreambuf_iterator<char>{}};
+  }
+
+}
+
+TEST(streaming, stream_gray) {
+  namespace fs = std::filesystem;
+  fs::path infile = fs::current_path() / "../../in/sabatini.bmp";
+  fs::path outdir = fs::current_path() / "../../out";
+  fs::create_directory(outdir);
+  images::common::stream_gray(infile, outdir / "sabatini_stream.bmp");
+  images::aos::bitmap_aos bm;
+  bm.read(infile);
+  bm.to_gray();
+  bm.write(outdir / "sabatini_gray.bmp");
+  EXPECT_EQ(file_contents(outdir / "sabatini_gray.bmp"),
+      file_contents(outdir / "sabatini_stream.bmp"));
+}
+
+TEST(streaming, stream_gray_palette) {
+  namespace fs = std::filesystem;
+  fs::path outdir = fs::current_path() / "../../out";
+  fs::create_directory(outdir);
+  images::aos::bitmap_aos bm;
+  bm.read(fs::current_path() / "../../in/sabatini.bmp");
+  bm.to_gray();
+  bm.write(outdir / "stream_gray8.bmp", true);
+  images::common::stream_gray(outdir / "stream_gray8.bmp", outdir / "stream_gray8_mono.bmp");
+  images::aos::bitmap_aos palettized;
+  palettized.read(outdir / "stream_gray8.bmp");
+  palettized.to_gray();
+  palettized.write(outdir / "stream_gray8_loaded.bmp");
+  EXPECT_EQ(file_contents(outdir / "stream_gray8_loaded.bmp"),
+      file_contents(outdir / "stream_gray8_mono.bmp"));
+}
+
+TEST(streaming, stream_gray_in_place) {
+  namespace fs = std::filesystem;
+  fs::path outdir = fs::current_path() / "../../out";
+  fs::create_directory(outdir);
+  const fs::path file = outdir / "self_stream.bmp";
+  fs::copy_file(fs::current_path() / "../../in/sabatini.bmp", file,
+      fs::copy_options::overwrite_existing);
+  const auto before = file_contents(file);
+  EXPECT_THROW(images::common::stream_gray(file, outdir / "." / "self_stream.bmp"),
+      images::common::file_error);
+  EXPECT_EQ(before, file_contents(file));
+}
+
+TEST(streaming, stream_gray_inexistent) {
+  namespace fs = std::filesystem;
+  fs::path infile = fs::current_path() / "../../in/none.bmp";
+  fs::path outdir = fs::current_path() / "../../out";
+  EXPECT_THROW(images::common::stream_gray(infile, outdir / "none.bmp"),
+      images::common::file_error);
+}
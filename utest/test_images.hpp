@@ -0,0 +1,21 @@
+#ifndef IMAGES_UTEST_TEST_IMAGES_HPP
+#define IMAGES_UTEST_TEST_IMAGES_HPP
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace images::test {
+
+  // size bytes of noise, the same for every call with the same size
+  inline std::vector<uint8_t> random_image(int size) {
+    std::mt19937 generator{static_cast<unsigned>(size)};
+    std::uniform_int_distribution<int> level{0, 255};
+    std::vector<uint8_t> data(static_cast<std::size_t>(size));
+    for (auto & x: data) { x = static_cast<uint8_t>(level(generator)); }
+    return data;
+  }
+
+}
+
+#endif //IMAGES_UTEST_TEST_IMAGES_HPP